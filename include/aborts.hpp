@@ -69,16 +69,24 @@ namespace NP {
 
 	template<class Time>
 	void validate_abort_refs(const std::vector<Abort_action<Time>>& aborts,
-	                         const typename Job<Time>::Job_set jobs)
+	                         const typename Job<Time>::Job_set& jobs,
+	                         const Job_id_map& index)
 	{
-		for (auto action : aborts) {
-			auto job = lookup<Time>(jobs, action.get_id());
+		for (const auto& action : aborts) {
+			const auto& job = lookup<Time>(jobs, index, action.get_id());
 			if (action.earliest_trigger_time() < job.earliest_arrival() ||
 			    action.latest_trigger_time() < job.latest_arrival())
 				throw InvalidAbortParameter(action.get_id());
 		}
 	}
 
+	template<class Time>
+	void validate_abort_refs(const std::vector<Abort_action<Time>>& aborts,
+	                         const typename Job<Time>::Job_set& jobs)
+	{
+		validate_abort_refs<Time>(aborts, jobs, Job_id_map(jobs));
+	}
+
 
 }
 
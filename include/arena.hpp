@@ -0,0 +1,191 @@
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <cassert>
+#include <memory>
+#include <vector>
+
+#include "config.h"
+
+#ifdef CONFIG_PARALLEL
+#include "tbb/enumerable_thread_specific.h"
+#endif
+
+namespace NP {
+
+	// A simple bump allocator. Memory is carved out of large chunks and
+	// is given back only when the whole arena is destroyed, which matches
+	// how the analysis engines use memory: all states of one exploration
+	// depth (and everything they reference) die together.
+	//
+	// In parallel builds, each thread allocates from its own chunks, so
+	// allocation does not require any synchronization.
+	class Arena
+	{
+		public:
+
+		// Chunks start small (many depths are tiny) and double in size
+		// up to the maximum.
+		static const std::size_t min_chunk_size = 1 << 16;
+		static const std::size_t max_chunk_size = 1 << 20;
+
+		Arena()
+		{
+		}
+
+		void* allocate(std::size_t bytes,
+		               std::size_t align = alignof(std::max_align_t))
+		{
+			// chunks are allocated with new[], so we can't do better
+			assert(align <= alignof(std::max_align_t));
+
+			Chunks& c = chunks();
+			auto p = align_up(c.next, align);
+			if (!p || p + bytes > c.end)
+				p = c.add_chunk(bytes);
+			c.next = p + bytes;
+			return p;
+		}
+
+		// Gives back the memory only if it is the most recent allocation
+		// of the calling thread (e.g., a state that was just merged);
+		// everything else is released together with the arena.
+		void deallocate(void* ptr, std::size_t bytes)
+		{
+			Chunks& c = chunks();
+			auto p = static_cast<char*>(ptr);
+			if (p + bytes == c.next && p >= c.begin)
+				c.next = p;
+		}
+
+		// total size of all chunks held by this arena
+		std::size_t bytes_reserved() const
+		{
+#ifdef CONFIG_PARALLEL
+			std::size_t n = 0;
+			for (const Chunks& c : thread_chunks)
+				n += c.reserved;
+			return n;
+#else
+			return thread_chunks.reserved;
+#endif
+		}
+
+		private:
+
+		struct Chunks {
+			std::vector<std::unique_ptr<char[]>> all;
+			char* begin;
+			char* next;
+			char* end;
+			std::size_t reserved;
+
+			Chunks()
+			: begin(nullptr)
+			, next(nullptr)
+			, end(nullptr)
+			, reserved(0)
+			{
+			}
+
+			char* add_chunk(std::size_t min_size)
+			{
+				auto size = all.empty() ? min_chunk_size :
+					std::min(2 * (std::size_t) (end - begin), max_chunk_size);
+				size = std::max(size, min_size);
+				all.emplace_back(new char[size]);
+				begin = next = all.back().get();
+				end = begin + size;
+				reserved += size;
+				return begin;
+			}
+		};
+
+		static char* align_up(char* p, std::size_t align)
+		{
+			auto a = reinterpret_cast<std::uintptr_t>(p);
+			return reinterpret_cast<char*>((a + align - 1) & ~(align - 1));
+		}
+
+#ifdef CONFIG_PARALLEL
+		tbb::enumerable_thread_specific<Chunks> thread_chunks;
+
+		Chunks& chunks()
+		{
+			return thread_chunks.local();
+		}
+#else
+		Chunks thread_chunks;
+
+		Chunks& chunks()
+		{
+			return thread_chunks;
+		}
+#endif
+
+		// no accidental copies
+		Arena(const Arena& origin) = delete;
+	};
+
+	// STL-compatible allocator that draws from an arena, or from the
+	// regular heap if no arena is given.
+	template<class T>
+	class Arena_allocator
+	{
+		public:
+
+		typedef T value_type;
+
+		Arena_allocator(Arena* arena = nullptr) noexcept
+		: arena(arena)
+		{
+		}
+
+		template<class U>
+		Arena_allocator(const Arena_allocator<U>& other) noexcept
+		: arena(other.arena)
+		{
+		}
+
+		T* allocate(std::size_t n)
+		{
+			if (arena)
+				return static_cast<T*>(
+					arena->allocate(n * sizeof(T), alignof(T)));
+			else
+				return std::allocator<T>().allocate(n);
+		}
+
+		void deallocate(T* p, std::size_t n)
+		{
+			if (arena)
+				arena->deallocate(p, n * sizeof(T));
+			else
+				std::allocator<T>().deallocate(p, n);
+		}
+
+		template<class U>
+		bool operator==(const Arena_allocator<U>& other) const
+		{
+			return arena == other.arena;
+		}
+
+		template<class U>
+		bool operator!=(const Arena_allocator<U>& other) const
+		{
+			return arena != other.arena;
+		}
+
+		private:
+
+		template<class U> friend class Arena_allocator;
+
+		Arena* arena;
+	};
+
+}
+
+#endif
@@ -0,0 +1,333 @@
+#ifndef BINARY_IO_HPP
+#define BINARY_IO_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "time.hpp"
+#include "interval.hpp"
+#include "jobs.hpp"
+#include "precedence.hpp"
+#include "aborts.hpp"
+#include "input_file.hpp"
+
+namespace NP {
+
+	// A binary job set file holds a workload (jobs, precedence
+	// constraints, and abort actions) so that it can be loaded without
+	// parsing. All values are stored as little-endian 64-bit words:
+	//
+	//   header (64 bytes):
+	//     magic[8] = "\x89NPJOBS\n"
+	//     u32 format version
+	//     u32 time model (0: discrete, i.e., int64; 1: dense, i.e.,
+	//         IEEE-754 double)
+	//     u64 number of jobs, n
+	//     u64 number of precedence constraints, e
+	//     u64 number of abort actions, a
+	//     u64 checksum of the payload (see checksum())
+	//     16 reserved bytes (zero)
+	//
+	//   payload, one column after the other (structure of arrays):
+	//     jobs:        task ID[n], job ID[n], arrival min[n],
+	//                  arrival max[n], cost min[n], cost max[n],
+	//                  deadline[n], priority[n]
+	//     constraints: predecessor task ID[e], predecessor job ID[e],
+	//                  successor task ID[e], successor job ID[e]
+	//     aborts:      task ID[a], job ID[a], trigger min[a],
+	//                  trigger max[a], cleanup min[a], cleanup max[a]
+
+	class Invalid_binary_job_set : public std::exception
+	{
+		public:
+
+		Invalid_binary_job_set(const std::string& problem)
+		: problem(problem)
+		{}
+
+		const std::string problem;
+
+		virtual const char* what() const noexcept override
+		{
+			return problem.c_str();
+		}
+	};
+
+	// the workload as given in the input files
+	template<class Time>
+	struct Workload_data
+	{
+		typename Job<Time>::Job_set jobs;
+		Precedence_constraints dag;
+		std::vector<Abort_action<Time>> aborts;
+	};
+
+	namespace Binary_job_set {
+
+		const char magic[8] = {'\x89', 'N', 'P', 'J', 'O', 'B', 'S', '\n'};
+		const std::uint32_t version = 1;
+		const std::size_t header_size = 64;
+
+		const std::size_t job_columns = 8;
+		const std::size_t constraint_columns = 4;
+		const std::size_t abort_columns = 6;
+
+		enum Time_model : std::uint32_t {
+			discrete = 0,
+			dense = 1
+		};
+
+		template<class Time>
+		Time_model time_model_of()
+		{
+			return std::is_floating_point<Time>::value ? dense : discrete;
+		}
+
+		inline bool little_endian_host()
+		{
+			const std::uint16_t one = 1;
+			unsigned char first;
+			std::memcpy(&first, &one, 1);
+			return first == 1;
+		}
+
+		inline std::uint64_t swap_bytes(std::uint64_t w)
+		{
+			std::uint64_t r = 0;
+			for (int i = 0; i < 8; i++, w >>= 8)
+				r = (r << 8) | (w & 0xff);
+			return r;
+		}
+
+		// the little-endian word at p (need not be aligned)
+		inline std::uint64_t load_word(const char* p)
+		{
+			std::uint64_t w;
+			std::memcpy(&w, p, sizeof(w));
+			return little_endian_host() ? w : swap_bytes(w);
+		}
+
+		inline void store_word(char* p, std::uint64_t w)
+		{
+			if (!little_endian_host())
+				w = swap_bytes(w);
+			std::memcpy(p, &w, sizeof(w));
+		}
+
+		// FNV-1a over 64-bit words
+		inline std::uint64_t checksum(const char* begin, std::size_t words)
+		{
+			std::uint64_t h = 0xcbf29ce484222325ULL;
+			for (std::size_t i = 0; i < words; i++)
+				h = (h ^ load_word(begin + 8 * i)) * 0x100000001b3ULL;
+			return h;
+		}
+
+		inline std::uint64_t word_of(dtime_t t)
+		{
+			return static_cast<std::uint64_t>(t);
+		}
+
+		inline std::uint64_t word_of(dense_t t)
+		{
+			std::uint64_t w;
+			std::memcpy(&w, &t, sizeof(w));
+			return w;
+		}
+
+		// converts a stored time value of the given model to Time
+		template<class Time>
+		Time time_of(std::uint64_t w, Time_model model)
+		{
+			if (model == discrete)
+				return static_cast<Time>(static_cast<dtime_t>(w));
+			dense_t t;
+			std::memcpy(&t, &w, sizeof(t));
+			return static_cast<Time>(t);
+		}
+
+		inline std::size_t payload_words(std::uint64_t n, std::uint64_t e,
+		                                 std::uint64_t a)
+		{
+			return job_columns * n + constraint_columns * e
+			       + abort_columns * a;
+		}
+	}
+
+	// Does the input start like a binary job set file?
+	inline bool is_binary_job_set(const Input_file& in)
+	{
+		return in.prefix(sizeof(Binary_job_set::magic))
+		       == std::string(Binary_job_set::magic,
+		                      sizeof(Binary_job_set::magic));
+	}
+
+	template<class Time>
+	void write_binary_job_set(std::ostream& out,
+	                          const Workload_data<Time>& w)
+	{
+		using namespace Binary_job_set;
+
+		const std::size_t n = w.jobs.size(), e = w.dag.size(),
+		                  a = w.aborts.size();
+		std::vector<char> file(header_size + 8 * payload_words(n, e, a), 0);
+
+		char* column = file.data() + header_size;
+		// store one column of values
+		auto put = [&] (std::size_t count, auto value) {
+			for (std::size_t i = 0; i < count; i++)
+				store_word(column + 8 * i, value(i));
+			column += 8 * count;
+		};
+
+		const auto& jobs = w.jobs;
+		put(n, [&] (std::size_t i) { return jobs[i].get_task_id(); });
+		put(n, [&] (std::size_t i) { return jobs[i].get_job_id(); });
+		put(n, [&] (std::size_t i) { return word_of(jobs[i].earliest_arrival()); });
+		put(n, [&] (std::size_t i) { return word_of(jobs[i].latest_arrival()); });
+		put(n, [&] (std::size_t i) { return word_of(jobs[i].least_cost()); });
+		put(n, [&] (std::size_t i) { return word_of(jobs[i].maximal_cost()); });
+		put(n, [&] (std::size_t i) { return word_of(jobs[i].get_deadline()); });
+		put(n, [&] (std::size_t i) { return word_of(jobs[i].get_priority()); });
+
+		const auto& dag = w.dag;
+		put(e, [&] (std::size_t i) { return dag[i].first.task; });
+		put(e, [&] (std::size_t i) { return dag[i].first.job; });
+		put(e, [&] (std::size_t i) { return dag[i].second.task; });
+		put(e, [&] (std::size_t i) { return dag[i].second.job; });
+
+		const auto& aborts = w.aborts;
+		put(a, [&] (std::size_t i) { return aborts[i].get_id().task; });
+		put(a, [&] (std::size_t i) { return aborts[i].get_id().job; });
+		put(a, [&] (std::size_t i) { return word_of(aborts[i].earliest_trigger_time()); });
+		put(a, [&] (std::size_t i) { return word_of(aborts[i].latest_trigger_time()); });
+		put(a, [&] (std::size_t i) { return word_of(aborts[i].least_cleanup_cost()); });
+		put(a, [&] (std::size_t i) { return word_of(aborts[i].maximum_cleanup_cost()); });
+
+		char* h = file.data();
+		std::memcpy(h, magic, sizeof(magic));
+		store_word(h + 8, version
+		                  | (std::uint64_t(time_model_of<Time>()) << 32));
+		store_word(h + 16, n);
+		store_word(h + 24, e);
+		store_word(h + 32, a);
+		store_word(h + 40, checksum(file.data() + header_size,
+		                            payload_words(n, e, a)));
+
+		out.write(file.data(), file.size());
+	}
+
+	// Loads the binary job set file held in [begin, end). Discrete-time
+	// files can be loaded in dense time, but not vice versa.
+	template<class Time>
+	Workload_data<Time> load_binary_job_set(const char* begin,
+	                                        const char* end,
+	                                        const std::string& file = "")
+	{
+		using namespace Binary_job_set;
+
+		auto fail = [&] (const std::string& problem) {
+			return Invalid_binary_job_set(
+				(file.empty() ? "" : file + ": ") + problem);
+		};
+
+		const std::size_t size = end - begin;
+		if (size < header_size || std::memcmp(begin, magic, sizeof(magic)))
+			throw fail("not a binary job set file");
+
+		const char* h = begin;
+		auto version_and_model = load_word(h + 8);
+		if ((version_and_model & 0xffffffff) != version)
+			throw fail("unsupported format version "
+			           + std::to_string(version_and_model & 0xffffffff));
+		auto model = Time_model(version_and_model >> 32);
+		if (model != discrete && model != dense)
+			throw fail("unknown time model");
+		if (model == dense && time_model_of<Time>() == discrete)
+			throw fail("dense-time job set cannot be analyzed in discrete time");
+
+		const std::uint64_t n = load_word(h + 16), e = load_word(h + 24),
+		                    a = load_word(h + 32);
+		const std::uint64_t max_words = (size - header_size) / 8;
+		if (n > max_words || e > max_words || a > max_words
+		    || payload_words(n, e, a) * 8 != size - header_size)
+			throw fail("truncated or oversized file");
+		if (checksum(h + header_size, payload_words(n, e, a))
+		    != load_word(h + 40))
+			throw fail("checksum mismatch");
+
+		const char* column = h + header_size;
+		// the i-th word of the k-th column of a section of count rows
+		auto word = [] (const char* section, std::uint64_t count,
+		                std::size_t k, std::size_t i) {
+			return load_word(section + 8 * (k * count + i));
+		};
+		auto id = [&] (const char* section, std::uint64_t count,
+		               std::size_t k, std::size_t i) {
+			return static_cast<unsigned long>(word(section, count, k, i));
+		};
+
+		Workload_data<Time> w;
+
+		w.jobs.reserve(n);
+		for (std::size_t i = 0; i < n; i++)
+			w.jobs.push_back(Job<Time>{
+				id(column, n, 1, i),
+				Interval<Time>{time_of<Time>(word(column, n, 2, i), model),
+				               time_of<Time>(word(column, n, 3, i), model)},
+				Interval<Time>{time_of<Time>(word(column, n, 4, i), model),
+				               time_of<Time>(word(column, n, 5, i), model)},
+				time_of<Time>(word(column, n, 6, i), model),
+				time_of<Time>(word(column, n, 7, i), model),
+				id(column, n, 0, i)});
+		column += 8 * job_columns * n;
+
+		w.dag.reserve(e);
+		for (std::size_t i = 0; i < e; i++)
+			w.dag.emplace_back(
+				JobID{id(column, e, 1, i), id(column, e, 0, i)},
+				JobID{id(column, e, 3, i), id(column, e, 2, i)});
+		column += 8 * constraint_columns * e;
+
+		w.aborts.reserve(a);
+		for (std::size_t i = 0; i < a; i++)
+			w.aborts.push_back(Abort_action<Time>{
+				JobID{id(column, a, 1, i), id(column, a, 0, i)},
+				Interval<Time>{time_of<Time>(word(column, a, 2, i), model),
+				               time_of<Time>(word(column, a, 3, i), model)},
+				Interval<Time>{time_of<Time>(word(column, a, 4, i), model),
+				               time_of<Time>(word(column, a, 5, i), model)}});
+
+		return w;
+	}
+
+	// The columns of an uncompressed file are read straight from the
+	// (memory-mapped) input.
+	template<class Time>
+	Workload_data<Time> load_binary_job_set(const Input_file& in)
+	{
+		Workload_data<Time> w;
+		if (!in.is_compressed()) {
+			in.for_each_block([&] (const char* begin, const char* end) {
+				w = load_binary_job_set<Time>(begin, end, in.name());
+			});
+		} else {
+			std::string contents;
+			in.for_each_block([&] (const char* begin, const char* end) {
+				contents.append(begin, end);
+			});
+			w = load_binary_job_set<Time>(contents.data(),
+			                              contents.data() + contents.size(),
+			                              in.name());
+		}
+		return w;
+	}
+
+}
+
+#endif
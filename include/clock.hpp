@@ -2,42 +2,70 @@
 #define CLOCK_HPP
 
 #include <time.h>
+#include <chrono>
 
 class Processor_clock {
 
+	public:
+
+	// By default, the clock measures the CPU time of the whole process.
+	// When several analyses run at the same time, their CPU time cannot
+	// be told apart, and each of them measures the elapsed (wall-clock)
+	// time instead.
+	enum Source { process_cpu_time, wall_clock_time };
+
 	private:
 
-	clock_t accum = 0, start_time = 0;
+	// in ticks of the source (clock() ticks or nanoseconds)
+	double accum = 0, start_time = 0;
 	bool running = false;
+	Source source;
+
+	double now() const
+	{
+		if (source == wall_clock_time)
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now().time_since_epoch()).count();
+		else
+			return clock();
+	}
 
-	static constexpr double scale_to_seconds = 1.0 / (double) CLOCKS_PER_SEC;
+	double scale_to_seconds() const
+	{
+		return source == wall_clock_time ? 1e-9 : 1.0 / (double) CLOCKS_PER_SEC;
+	}
 
 	public:
 
+	Processor_clock(Source source = process_cpu_time)
+	: source(source)
+	{
+	}
+
 	void start()
 	{
 		running = true;
-		start_time = clock();
+		start_time = now();
 	}
 
 
 	double stop()
 	{
-		auto delta = clock() - start_time;
+		auto delta = now() - start_time;
 		if (running) {
 			accum += delta;
 			running = false;
-			return delta * scale_to_seconds;
+			return delta * scale_to_seconds();
 		}
 		else
 			return 0;
 	}
 
 	operator double() const {
-		clock_t extra = 0;
+		double extra = 0;
 		if (running)
-			extra = clock() - start_time;
-		return (accum + extra) * scale_to_seconds;
+			extra = now() - start_time;
+		return (accum + extra) * scale_to_seconds();
 	}
 
 };
@@ -0,0 +1,239 @@
+#ifndef CSV_HPP
+#define CSV_HPP
+
+#include <cerrno>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <ios>
+#include <limits>
+#include <string>
+#include <type_traits>
+
+namespace NP {
+
+	// A malformed row in an input file (lines and columns count from 1).
+	class Parse_error : public std::ios_base::failure
+	{
+		public:
+
+		Parse_error(const std::string& file, std::size_t line,
+		            std::size_t column, const std::string& problem)
+		: std::ios_base::failure(problem)
+		, file(file)
+		, line(line)
+		, column(column)
+		, problem(problem)
+		, message((file.empty() ? "" : file + ":")
+		          + std::to_string(line) + ":" + std::to_string(column)
+		          + ": " + problem)
+		{
+		}
+
+		const std::string file;
+		const std::size_t line;
+		const std::size_t column;
+		const std::string problem;
+
+		virtual const char* what() const noexcept override
+		{
+			return message.c_str();
+		}
+
+		private:
+
+		const std::string message;
+	};
+
+	// Reads the comma-separated fields of the rows of an input file
+	// that is held in memory in [begin, end). Fields may be padded with
+	// blanks, and the numbers are parsed in place (without going through
+	// a stream and its locale).
+	class Csv_reader
+	{
+		public:
+
+		Csv_reader(const char* begin, const char* end,
+		           const std::string& file = "", std::size_t first_line = 1)
+		: pos(begin)
+		, end(end)
+		, line_start(begin)
+		, line_number(first_line)
+		, file(file)
+		{
+		}
+
+		// Skips blank lines. Returns true if there is another row.
+		bool more_rows()
+		{
+			while (true) {
+				skip_blanks();
+				if (pos == end)
+					return false;
+				if (*pos != '\n' && *pos != '\r')
+					return true;
+				next_line();
+			}
+		}
+
+		// skips the rest of the current line (e.g., extra columns)
+		void next_line()
+		{
+			auto nl = static_cast<const char*>(
+				std::memchr(pos, '\n', end - pos));
+			if (nl) {
+				pos = nl + 1;
+				line_start = pos;
+				line_number++;
+			} else
+				pos = end;
+		}
+
+		// moves on to the next field of the current row
+		void next_field()
+		{
+			skip_blanks();
+			if (pos == end || *pos != ',')
+				fail(pos, "expected ','");
+			pos++;
+		}
+
+		// reads the current field as a number of type T
+		template<typename T>
+		T number()
+		{
+			skip_blanks();
+			return read<T>(std::is_floating_point<T>());
+		}
+
+		const char* position() const
+		{
+			return pos;
+		}
+
+		std::size_t line() const
+		{
+			return line_number;
+		}
+
+		private:
+
+		const char* pos;
+		const char* end;
+		const char* line_start;
+		std::size_t line_number;
+		std::string file;
+
+		[[noreturn]] void fail(const char* where, const std::string& problem)
+		{
+			throw Parse_error(file, line_number, where - line_start + 1,
+			                  problem);
+		}
+
+		void skip_blanks()
+		{
+			while (pos != end && (*pos == ' ' || *pos == '\t'))
+				pos++;
+		}
+
+		static bool is_digit(char c)
+		{
+			return c >= '0' && c <= '9';
+		}
+
+		static bool ends_field(char c)
+		{
+			return c == ',' || c == ' ' || c == '\t' || c == '\r'
+			       || c == '\n';
+		}
+
+		// integers (IDs and discrete time)
+		template<typename T>
+		T read(std::false_type)
+		{
+			typedef typename std::make_unsigned<T>::type U;
+
+			const char* start = pos;
+			bool negative = false;
+			if (pos != end && (*pos == '-' || *pos == '+')) {
+				negative = *pos == '-';
+				pos++;
+			}
+			if (negative && !std::is_signed<T>::value)
+				fail(start, "expected a non-negative integer");
+			if (pos == end || !is_digit(*pos))
+				fail(start, "expected an integer");
+
+			const U limit = U(std::numeric_limits<T>::max()) + U(negative);
+			U value = 0;
+			for (; pos != end && is_digit(*pos); pos++) {
+				U digit = *pos - '0';
+				if (value > (limit - digit) / 10)
+					fail(start, "integer out of range");
+				value = value * 10 + digit;
+			}
+			return negative ? T(U(0) - value) : T(value);
+		}
+
+		// floating-point numbers (dense time)
+		template<typename T>
+		T read(std::true_type)
+		{
+			const char* start = pos;
+			const char* p = pos;
+
+			// Fast path for plain decimals with at most 15 digits: the
+			// digits and the power of ten are then exact doubles, so a
+			// single division yields the correctly rounded value, just
+			// like strtod() would.
+			bool negative = false;
+			if (p != end && (*p == '-' || *p == '+')) {
+				negative = *p == '-';
+				p++;
+			}
+			std::uint64_t digits = 0;
+			int num_digits = 0, frac_digits = 0;
+			for (; p != end && is_digit(*p); p++, num_digits++)
+				digits = digits * 10 + (*p - '0');
+			if (p != end && *p == '.')
+				for (p++; p != end && is_digit(*p); p++, frac_digits++)
+					digits = digits * 10 + (*p - '0');
+			num_digits += frac_digits;
+			if (num_digits > 0 && num_digits <= 15
+			    && (p == end || ends_field(*p))) {
+				static const double powers_of_ten[] = {
+					1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8,
+					1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15
+				};
+				double value = (double) digits / powers_of_ten[frac_digits];
+				pos = p;
+				return T(negative ? -value : value);
+			}
+
+			// anything else (exponents, long mantissas, ...)
+			const char* token_end = start;
+			while (token_end != end && !ends_field(*token_end))
+				token_end++;
+			char token[64];
+			std::size_t len = token_end - start;
+			if (len == 0 || len >= sizeof(token))
+				fail(start, "expected a number");
+			std::memcpy(token, start, len);
+			token[len] = '\0';
+			char* parsed_end;
+			errno = 0;
+			double value = std::strtod(token, &parsed_end);
+			if (parsed_end != token + len)
+				fail(start, "expected a number");
+			if (errno == ERANGE && std::isinf(value))
+				fail(start, "number out of range");
+			pos = token_end;
+			return T(value);
+		}
+	};
+
+}
+
+#endif
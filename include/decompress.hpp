@@ -0,0 +1,399 @@
+#ifndef DECOMPRESS_HPP
+#define DECOMPRESS_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <condition_variable>
+#include <cstddef>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#ifdef CONFIG_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef CONFIG_ZSTD
+#include <zstd.h>
+#endif
+
+namespace NP {
+
+	enum class Compression { none, gzip, zstd };
+
+	// recognizes compressed data by its magic number
+	inline Compression compression_of(const char* data, std::size_t size)
+	{
+		auto starts_with = [&] (const char* magic, std::size_t n) {
+			return size >= n && !std::memcmp(data, magic, n);
+		};
+		if (starts_with("\x1f\x8b", 2))
+			return Compression::gzip;
+		else if (starts_with("\x28\xb5\x2f\xfd", 4))
+			return Compression::zstd;
+		else
+			return Compression::none;
+	}
+
+	class Decompression_error : public std::exception
+	{
+		public:
+
+		Decompression_error(const std::string& problem)
+		: problem(problem)
+		{}
+
+		const std::string problem;
+
+		virtual const char* what() const noexcept override
+		{
+			return problem.c_str();
+		}
+	};
+
+#ifdef CONFIG_ZLIB
+	// gzip (or zlib) data, possibly several concatenated members
+	class Gzip_decoder
+	{
+		public:
+
+		Gzip_decoder(const char* data, std::size_t size)
+		: next(data)
+		, left(size)
+		, at_end(false)
+		{
+			std::memset(&zs, 0, sizeof(zs));
+			// 32: detect the gzip or zlib header
+			if (inflateInit2(&zs, 15 + 32) != Z_OK)
+				throw Decompression_error("cannot initialize zlib");
+		}
+
+		~Gzip_decoder()
+		{
+			inflateEnd(&zs);
+		}
+
+		Gzip_decoder(const Gzip_decoder&) = delete;
+		Gzip_decoder& operator=(const Gzip_decoder&) = delete;
+
+		// Decompresses up to n bytes into out. Returns how many bytes
+		// were produced (less than n only at the end of the data).
+		std::size_t read(char* out, std::size_t n)
+		{
+			std::size_t produced = 0;
+			while (produced < n && !at_end) {
+				refill();
+				auto room = std::min<std::size_t>(n - produced, UINT_MAX);
+				zs.next_out = reinterpret_cast<Bytef*>(out + produced);
+				zs.avail_out = (uInt) room;
+				int r = inflate(&zs, Z_NO_FLUSH);
+				produced += room - zs.avail_out;
+				if (r == Z_STREAM_END) {
+					refill();
+					if (zs.avail_in == 0)
+						at_end = true;
+					else
+						inflateReset(&zs);
+				} else if (r == Z_BUF_ERROR)
+					throw Decompression_error("truncated gzip data");
+				else if (r != Z_OK)
+					throw Decompression_error(zs.msg ? zs.msg
+					                                 : "corrupt gzip data");
+			}
+			return produced;
+		}
+
+		private:
+
+		z_stream zs;
+		const char* next;
+		std::size_t left;
+		bool at_end;
+
+		// avail_in is only 32 bits wide
+		void refill()
+		{
+			if (zs.avail_in == 0 && left > 0) {
+				auto n = std::min<std::size_t>(left, UINT_MAX);
+				zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(next));
+				zs.avail_in = (uInt) n;
+				next += n;
+				left -= n;
+			}
+		}
+	};
+#endif
+
+#ifdef CONFIG_ZSTD
+	// zstd data, possibly several concatenated frames
+	class Zstd_decoder
+	{
+		public:
+
+		Zstd_decoder(const char* data, std::size_t size)
+		: ds(ZSTD_createDStream())
+		, frame_done(false)
+		{
+			if (!ds)
+				throw Decompression_error("cannot initialize zstd");
+			ZSTD_initDStream(ds);
+			input.src = data;
+			input.size = size;
+			input.pos = 0;
+		}
+
+		~Zstd_decoder()
+		{
+			ZSTD_freeDStream(ds);
+		}
+
+		Zstd_decoder(const Zstd_decoder&) = delete;
+		Zstd_decoder& operator=(const Zstd_decoder&) = delete;
+
+		// see Gzip_decoder::read()
+		std::size_t read(char* out, std::size_t n)
+		{
+			ZSTD_outBuffer output = {out, n, 0};
+			while (output.pos < output.size
+			       && !(input.pos == input.size && frame_done)) {
+				auto r = ZSTD_decompressStream(ds, &output, &input);
+				if (ZSTD_isError(r))
+					throw Decompression_error(ZSTD_getErrorName(r));
+				frame_done = r == 0;
+				// with room left in the output, the decoder has
+				// flushed everything it could
+				if (input.pos == input.size && output.pos < output.size
+				    && !frame_done)
+					throw Decompression_error("truncated zstd data");
+			}
+			return output.pos;
+		}
+
+		private:
+
+		ZSTD_DStream* ds;
+		ZSTD_inBuffer input;
+		// the last frame has been decoded and flushed completely
+		bool frame_done;
+	};
+#endif
+
+	// Decompresses data in a separate thread, so that the consumer can
+	// work on the text while the rest is being decompressed. The text is
+	// handed out in blocks of about block_size bytes that end at line
+	// breaks (i.e., no line is split between two blocks). At most
+	// max_queued blocks are kept waiting for the consumer.
+	class Decompressing_stream
+	{
+		public:
+
+		Decompressing_stream(Compression compression,
+		                     const char* data, std::size_t size,
+		                     std::size_t block_size = 1 << 20,
+		                     std::size_t max_queued = 4)
+		: block_size(block_size)
+		, max_queued(max_queued)
+		, done(false)
+		, stopped(false)
+		, busy_time(0)
+		{
+			check_support(compression);
+			worker = std::thread([=] () { run(compression, data, size); });
+		}
+
+		~Decompressing_stream()
+		{
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				stopped = true;
+			}
+			changed.notify_all();
+			worker.join();
+		}
+
+		Decompressing_stream(const Decompressing_stream&) = delete;
+		Decompressing_stream& operator=(const Decompressing_stream&) = delete;
+
+		// Waits for the next block. Returns false at the end of the data,
+		// and rethrows any error of the decompressor.
+		bool next(std::string& block)
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			changed.wait(lock, [this] () { return !queue.empty() || done; });
+			if (queue.empty()) {
+				if (error)
+					std::rethrow_exception(error);
+				return false;
+			}
+			block = std::move(queue.front());
+			queue.pop_front();
+			changed.notify_all();
+			return true;
+		}
+
+		// the time (in seconds) spent decompressing so far
+		double decompression_time() const
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			return busy_time;
+		}
+
+		// Decompresses the first (up to) n bytes of the data.
+		static std::string prefix(Compression compression,
+		                          const char* data, std::size_t size,
+		                          std::size_t n)
+		{
+			check_support(compression);
+			std::string text(n, '\0');
+			text.resize(read(compression, data, size, &text[0], n));
+			return text;
+		}
+
+		private:
+
+		const std::size_t block_size;
+		const std::size_t max_queued;
+
+		mutable std::mutex mutex;
+		std::condition_variable changed;
+		std::deque<std::string> queue;
+		bool done;
+		bool stopped;
+		std::exception_ptr error;
+		double busy_time;
+
+		std::thread worker;
+
+		static void check_support(Compression compression)
+		{
+#ifndef CONFIG_ZLIB
+			if (compression == Compression::gzip)
+				throw Decompression_error("gzip-compressed input, but "
+					"built without zlib support (USE_ZLIB)");
+#endif
+#ifndef CONFIG_ZSTD
+			if (compression == Compression::zstd)
+				throw Decompression_error("zstd-compressed input is not "
+					"supported (built without USE_ZSTD)");
+#endif
+			(void) compression;
+		}
+
+		// Calls consume(read) until it returns false, where read(out, n)
+		// decompresses the next (up to) n bytes of data into out.
+		template<typename Consume>
+		static void decompress(Compression compression,
+		                       const char* data, std::size_t size,
+		                       Consume consume)
+		{
+			switch (compression) {
+#ifdef CONFIG_ZLIB
+			case Compression::gzip: {
+				Gzip_decoder d(data, size);
+				while (consume([&] (char* out, std::size_t n) {
+					return d.read(out, n);
+				}))
+					/* continue */;
+				break;
+			}
+#endif
+#ifdef CONFIG_ZSTD
+			case Compression::zstd: {
+				Zstd_decoder d(data, size);
+				while (consume([&] (char* out, std::size_t n) {
+					return d.read(out, n);
+				}))
+					/* continue */;
+				break;
+			}
+#endif
+			default:
+				(void) data;
+				(void) size;
+				(void) consume;
+				break;
+			}
+		}
+
+		static std::size_t read(Compression compression,
+		                        const char* data, std::size_t size,
+		                        char* out, std::size_t n)
+		{
+			std::size_t got = 0;
+			decompress(compression, data, size, [&] (auto read) {
+				got = read(out, n);
+				return false;
+			});
+			return got;
+		}
+
+		void run(Compression compression, const char* data, std::size_t size)
+		{
+			try {
+				// decompressed text that has not been handed out yet
+				std::string pending;
+				decompress(compression, data, size, [&] (auto read) {
+					auto start = std::chrono::steady_clock::now();
+					auto old_size = pending.size();
+					pending.resize(old_size + block_size);
+					auto n = read(&pending[old_size], block_size);
+					pending.resize(old_size + n);
+					std::chrono::duration<double> took =
+						std::chrono::steady_clock::now() - start;
+					{
+						std::lock_guard<std::mutex> lock(mutex);
+						busy_time += took.count();
+					}
+
+					if (n == 0)
+						return false;
+					if (pending.size() < block_size)
+						return true;
+					auto cut = pending.rfind('\n');
+					if (cut == std::string::npos)
+						return true;
+					std::string rest = pending.substr(cut + 1);
+					pending.resize(cut + 1);
+					if (!hand_out(pending))
+						return false;
+					pending = std::move(rest);
+					return true;
+				});
+				if (!pending.empty())
+					hand_out(pending);
+			} catch (...) {
+				std::lock_guard<std::mutex> lock(mutex);
+				error = std::current_exception();
+			}
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				done = true;
+			}
+			changed.notify_all();
+		}
+
+		// Waits for room in the queue. Returns false if the consumer
+		// has gone away.
+		bool hand_out(std::string& block)
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			changed.wait(lock, [this] () {
+				return queue.size() < max_queued || stopped;
+			});
+			if (stopped)
+				return false;
+			queue.push_back(std::move(block));
+			changed.notify_all();
+			return true;
+		}
+	};
+
+}
+
+#endif
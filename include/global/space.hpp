@@ -7,6 +7,7 @@
 #include <deque>
 #include <forward_list>
 #include <algorithm>
+#include <memory>
 
 #include <iostream>
 #include <ostream>
@@ -18,10 +19,21 @@
 #include "tbb/concurrent_hash_map.h"
 #include "tbb/enumerable_thread_specific.h"
 #include "tbb/parallel_for.h"
+#include "tbb/parallel_invoke.h"
+#include "tbb/blocked_range.h"
+#include "tbb/task_arena.h"
+#ifdef CONFIG_SHARDED_STATE_CACHE
+#include "sharded_cache.hpp"
+#endif
 #endif
 
 #include "problem.hpp"
 #include "clock.hpp"
+#include "zobrist.hpp"
+#include "arena.hpp"
+#include "response_times.hpp"
+#include "sorted_index.hpp"
+#include "job_table.hpp"
 
 #include "global/state.hpp"
 
@@ -44,11 +56,19 @@ namespace NP {
 				// doesn't yet support exploration after deadline miss
 				assert(opts.early_exit);
 
-				auto s = State_space(prob.jobs, prob.dag, prob.num_processors, opts.timeout,
+				auto s = State_space(prob.jobs, prob.job_index, prob.dag, prob.num_processors, opts.timeout,
 				                     opts.max_depth, opts.num_buckets);
 				s.be_naive = opts.be_naive;
+				s.use_arenas = opts.use_arenas;
+				if (opts.use_wall_clock)
+					s.cpu_time = Processor_clock(Processor_clock::wall_clock_time);
 				s.cpu_time.start();
-				s.explore();
+#ifdef CONFIG_PARALLEL
+				if (opts.deterministic)
+					s.explore_deterministically();
+				else
+#endif
+					s.explore();
 				s.cpu_time.stop();
 				return s;
 
@@ -77,12 +97,11 @@ namespace NP {
 
 			Interval<Time> get_finish_times(const Job<Time>& j) const
 			{
-				auto rbounds = rta.find(j.get_id());
-				if (rbounds == rta.end()) {
+				auto i = job_index.find(j.get_id());
+				if (i == Job_id_map::npos)
 					return Interval<Time>{0, Time_model::constants<Time>::infinity()};
-				} else {
-					return rbounds->second;
-				}
+				else
+					return finish_times_of(i);
 			}
 
 			bool is_schedulable() const
@@ -110,6 +129,26 @@ namespace NP {
 				return width;
 			}
 
+			// number of times that a lookup in the state cache found a
+			// state with the same key, but different scheduled jobs
+			unsigned long number_of_key_collisions() const
+			{
+				return num_key_collisions;
+			}
+
+			// largest amount of memory (in bytes) held by the per-depth
+			// arenas at any one time (zero if arenas are not used)
+			std::size_t arena_memory_high_water() const
+			{
+				return arena_high_water;
+			}
+
+			// how the jobs are spread over the buckets of jobs_by_win
+			Lookup_table_occupancy lookup_table_occupancy() const
+			{
+				return jobs_by_win.occupancy();
+			}
+
 			double get_cpu_time() const
 			{
 				return cpu_time;
@@ -184,21 +223,26 @@ namespace NP {
 			typedef typename std::deque<State>::iterator State_ref;
 			typedef typename std::forward_list<State_ref> State_refs;
 
-#ifdef CONFIG_PARALLEL
+			typedef std::unordered_map<hash_value_t, State_refs> Local_states_map;
+
+#if defined(CONFIG_PARALLEL) && defined(CONFIG_SHARDED_STATE_CACHE)
+			typedef Sharded_cache<State_ref> States_map;
+#elif defined(CONFIG_PARALLEL)
 			typedef tbb::concurrent_hash_map<hash_value_t, State_refs> States_map;
 			typedef typename States_map::accessor States_map_accessor;
 #else
-			typedef std::unordered_map<hash_value_t, State_refs> States_map;
+			typedef Local_states_map States_map;
 #endif
 
 			typedef const Job<Time>* Job_ref;
-			typedef std::multimap<Time, Job_ref> By_time_map;
+			typedef Jobs_by_time<Time> By_time_map;
 
 			typedef std::deque<State_ref> Todo_queue;
 
 			typedef Interval_lookup_table<Time, Job<Time>, Job<Time>::scheduling_window> Jobs_lut;
 
-			typedef std::unordered_map<JobID, Interval<Time> > Response_times;
+			typedef NP::Response_times<Time> Response_times;
+			typedef NP::Finish_time_updates<Time> Finish_time_updates;
 
 #ifdef CONFIG_COLLECT_SCHEDULE_GRAPH
 			std::deque<Edge> edges;
@@ -207,7 +251,18 @@ namespace NP {
 			Response_times rta;
 
 #ifdef CONFIG_PARALLEL
+			// in parallel runs, each thread keeps its own bounds until the
+			// exploration is done
 			tbb::enumerable_thread_specific<Response_times> partial_rta;
+
+			// Updates of the finish times of jobs with successors, which
+			// are looked up during the exploration. In parallel runs, they
+			// are folded into rta only once the current depth is done.
+			tbb::enumerable_thread_specific<Finish_time_updates> pending_rta;
+
+			// Do updates go straight to rta, as in a sequential run?
+			// (Only while a single thread explores the states.)
+			bool immediate_rta;
 #endif
 
 			bool aborted;
@@ -224,7 +279,19 @@ namespace NP {
 			By_time_map _jobs_by_latest_arrival;
 			By_time_map _jobs_by_earliest_arrival;
 			By_time_map _jobs_by_deadline;
-			std::vector<Job_precedence_set> _predecessors;
+			Job_dependencies dependencies;
+			// what the initial state has dispatched (nothing), with the
+			// jobs that wait for predecessors
+			std::unique_ptr<const Dispatched_jobs> nothing_dispatched;
+			// latest arrivals and priority ranks of the jobs
+			Job_table<Time> job_table;
+			// The jobs in each bucket of jobs_by_win, split into the jobs
+			// without predecessors (which are scanned as a whole) and the
+			// others (which are checked one by one).
+			std::vector<Job_scan_list<Time>> independent_jobs_by_win;
+			std::vector<std::vector<Job_ref>> dependent_jobs_by_win;
+			// positions of the jobs in the workload, by ID
+			const Job_id_map job_index;
 
 			// use these const references to ensure read-only access
 			const Jobs_lut& jobs_by_win;
@@ -233,16 +300,33 @@ namespace NP {
 			const By_time_map& jobs_by_deadline;
 			const std::vector<Job_precedence_set>& predecessors;
 
+			// random keys of the jobs (for the state lookup keys)
+			const Zobrist_keys job_keys;
+
+			// memory for the states (and their job sets), one arena per
+			// entry in states_storage; declared before states_storage and
+			// job_set_pools so that they outlive the states and job sets
+			// allocated from them
+			std::deque<Arena> arenas;
+			bool use_arenas;
+			std::size_t arena_high_water;
+
 			States_storage states_storage;
 
+			// interned sets of scheduled jobs, one pool per entry in
+			// states_storage
+			std::deque<Job_set_pool> job_set_pools;
+
 			States_map states_by_key;
 			// updated only by main thread
 			unsigned long num_states, width;
 			unsigned long current_job_count;
 			unsigned long num_edges;
+			unsigned long num_key_collisions;
 
 #ifdef CONFIG_PARALLEL
 			tbb::enumerable_thread_specific<unsigned long> edge_counter;
+			tbb::enumerable_thread_specific<unsigned long> collision_counter;
 #endif
 			Processor_clock cpu_time;
 			const double timeout;
@@ -250,43 +334,54 @@ namespace NP {
 			const unsigned int num_cpus;
 
 			State_space(const Workload& jobs,
+			            const Job_id_map& job_index,
 			            const Precedence_constraints &dag_edges,
 			            unsigned int num_cpus,
 			            double max_cpu_time = 0,
 			            unsigned int max_depth = 0,
 			            std::size_t num_buckets = 1000)
-			: _jobs_by_win(Interval<Time>{0, max_deadline(jobs)},
-			               max_deadline(jobs) / num_buckets)
+			: rta(jobs.size())
+#ifdef CONFIG_PARALLEL
+			, partial_rta(Response_times(jobs.size()))
+			, immediate_rta(false)
+#endif
+			, _jobs_by_win(make_lookup_table(jobs, num_buckets))
 			, jobs(jobs)
 			, aborted(false)
 			, timed_out(false)
 			, be_naive(false)
 			, timeout(max_cpu_time)
 			, max_depth(max_depth)
+			, _jobs_by_latest_arrival(sort_jobs_by(jobs, &Job<Time>::latest_arrival))
+			, _jobs_by_earliest_arrival(sort_jobs_by(jobs, &Job<Time>::earliest_arrival))
+			, _jobs_by_deadline(sort_jobs_by(jobs, &Job<Time>::get_deadline))
+			, dependencies(make_dependencies(jobs, job_index, dag_edges))
+			, nothing_dispatched(new Dispatched_jobs(dependencies))
+			, job_table(jobs)
+			, job_index(job_index)
+			, use_arenas(true)
+			, arena_high_water(0)
 			, num_states(0)
 			, num_edges(0)
 			, width(0)
 			, current_job_count(0)
+			, num_key_collisions(0)
 			, num_cpus(num_cpus)
 			, jobs_by_latest_arrival(_jobs_by_latest_arrival)
 			, jobs_by_earliest_arrival(_jobs_by_earliest_arrival)
 			, jobs_by_deadline(_jobs_by_deadline)
 			, jobs_by_win(_jobs_by_win)
-			, _predecessors(jobs.size())
-			, predecessors(_predecessors)
-			{
-				for (const Job<Time>& j : jobs) {
-					_jobs_by_latest_arrival.insert({j.latest_arrival(), &j});
-					_jobs_by_earliest_arrival.insert({j.earliest_arrival(), &j});
-					_jobs_by_deadline.insert({j.get_deadline(), &j});
-					_jobs_by_win.insert(j);
-				}
-
-				for (auto e : dag_edges) {
-					const Job<Time>& from = lookup<Time>(jobs, e.first);
-					const Job<Time>& to   = lookup<Time>(jobs, e.second);
-					_predecessors[index_of(to)].push_back(index_of(from));
-				}
+			, predecessors(dependencies.predecessors)
+			, job_keys(jobs.size())
+			{
+				independent_jobs_by_win.resize(jobs_by_win.size());
+				dependent_jobs_by_win.resize(jobs_by_win.size());
+				for (std::size_t b = 0; b < jobs_by_win.size(); b++)
+					for (const Job<Time>& j : jobs_by_win.bucket(b))
+						if (predecessors_of(j).empty())
+							independent_jobs_by_win[b].push_back(job_table, index_of(j));
+						else
+							dependent_jobs_by_win[b].push_back(&j);
 			}
 
 			private:
@@ -300,6 +395,15 @@ namespace NP {
 #endif
 			}
 
+			void count_key_collision()
+			{
+#ifdef CONFIG_PARALLEL
+				collision_counter.local()++;
+#else
+				num_key_collisions++;
+#endif
+			}
+
 			static Time max_deadline(const Workload &jobs)
 			{
 				Time dl = 0;
@@ -308,55 +412,100 @@ namespace NP {
 				return dl;
 			}
 
-			void update_finish_times(Response_times& r, const JobID& id,
-			                         Interval<Time> range)
+			// Index the jobs by their scheduling windows, either in
+			// buckets of uniform width or in buckets balanced by where the
+			// windows start (which helps with bursts of releases),
+			// whichever yields the smaller lookups for this workload.
+			static Jobs_lut make_lookup_table(const Workload &jobs,
+			                                  std::size_t num_buckets)
 			{
-				auto rbounds = r.find(id);
-				if (rbounds == r.end()) {
-					r.emplace(id, range);
-				} else {
-					rbounds->second |= range;
+				Interval<Time> range{0, max_deadline(jobs)};
+
+				Jobs_lut uniform(range, max_deadline(jobs) / num_buckets);
+				Jobs_lut balanced(range, Jobs_lut::balanced_bucket_starts(
+				                             range, jobs, num_buckets));
+
+				Jobs_lut& lut = balanced.occupancy_with(jobs).typical
+				                < uniform.occupancy_with(jobs).typical
+				                ? balanced : uniform;
+				for (const Job<Time>& j : jobs)
+					lut.insert(j);
+				return std::move(lut);
+			}
+
+			static Job_dependencies make_dependencies(
+				const Workload& jobs,
+				const Job_id_map& job_index,
+				const Precedence_constraints& dag_edges)
+			{
+				Job_dependencies deps(jobs.size());
+				for (auto e : dag_edges) {
+					auto from = job_index.index_of(e.first);
+					auto to   = job_index.index_of(e.second);
+					deps.predecessors[to].push_back(from);
+					deps.successors[from].push_back(to);
 				}
-				DM("RTA " << id << ": " << r.find(id)->second << std::endl);
+				return deps;
 			}
 
-			void update_finish_times(
-				Response_times& r, const Job<Time>& j, Interval<Time> range)
+			// is the job a predecessor of some other job?
+			bool has_successors(std::size_t i) const
 			{
-				update_finish_times(r, j.get_id(), range);
-				if (j.exceeds_deadline(range.upto()))
-					aborted = true;
+				return !dependencies.successors[i].empty();
 			}
 
 			void update_finish_times(const Job<Time>& j, Interval<Time> range)
 			{
-				Response_times& r =
+				auto i = index_of(j);
 #ifdef CONFIG_PARALLEL
-					partial_rta.local();
+				if (immediate_rta) {
+					rta.update(i, range);
+				} else {
+					partial_rta.local().update(i, range);
+					if (has_successors(i))
+						pending_rta.local().emplace_back(i, range);
+				}
 #else
-					rta;
+				rta.update(i, range);
 #endif
-				update_finish_times(r, j, range);
+				DM("RTA " << j.get_id() << ": " << range << std::endl);
+				if (j.exceeds_deadline(range.upto()))
+					aborted = true;
 			}
 
+			// the bounds on the finish times of the job at position i
+			// in the workload that are known so far
+			Interval<Time> finish_times_of(std::size_t i) const
+			{
+				if (!rta.contains(i))
+					return Interval<Time>{0, Time_model::constants<Time>::infinity()};
+				else
+					return rta[i];
+			}
 
 			std::size_t index_of(const Job<Time>& j) const
 			{
 				return (std::size_t) (&j - &(jobs[0]));
 			}
 
+			hash_value_t job_key(const Job<Time>& j) const
+			{
+				return job_keys[index_of(j)];
+			}
+
 			const Job_precedence_set& predecessors_of(const Job<Time>& j) const
 			{
 				return predecessors[index_of(j)];
 			}
 
-			void check_for_deadline_misses(const State& old_s, const State& new_s)
+			// Returns a job that was skipped in the transition from old_s to
+			// new_s and that now certainly misses its deadline (or nullptr).
+			const Job<Time>* skipped_deadline_miss(
+				const State& old_s, const State& new_s) const
 			{
 				auto check_from = old_s.core_availability().min();
 				auto earliest   = new_s.core_availability().min();
 
-				// check if we skipped any jobs that are now guaranteed
-				// to miss their deadline
 				for (auto it = jobs_by_deadline.lower_bound(check_from);
 				     it != jobs_by_deadline.end(); it++) {
 					const Job<Time>& j = *(it->second);
@@ -365,32 +514,87 @@ namespace NP {
 							DM("deadline miss: " << new_s << " -> " << j << std::endl);
 							// This job is still incomplete but has no chance
 							// of being scheduled before its deadline anymore.
-							// Abort.
-							aborted = true;
-							// create a dummy state for explanation purposes
-							auto frange = new_s.core_availability() + j.get_cost();
-							const State& next =
-								new_state(new_s, index_of(j), predecessors_of(j),
-								          frange, frange, j.get_key());
-							// update response times
-							update_finish_times(j, frange);
-#ifdef CONFIG_COLLECT_SCHEDULE_GRAPH
-							edges.emplace_back(&j, &new_s, &next, frange);
-#endif
-							count_edge();
-							break;
+							return &j;
 						}
 					} else
 						// deadlines now after the next earliest finish time
 						break;
 				}
+				return nullptr;
+			}
+
+			void check_for_deadline_misses(const State& old_s, const State& new_s)
+			{
+				// check if we skipped any jobs that are now guaranteed
+				// to miss their deadline
+				const Job<Time>* missed = skipped_deadline_miss(old_s, new_s);
+				if (!missed)
+					return;
+
+				const Job<Time>& j = *missed;
+				// Abort.
+				aborted = true;
+				// create a dummy state for explanation purposes
+				auto frange = new_s.core_availability() + j.get_cost();
+				const State& next =
+					new_state(new_s, index_of(j), predecessors_of(j),
+					          frange, frange, job_key(j), job_sets(),
+					          depth_arena());
+				// update response times
+				update_finish_times(j, frange);
+#ifdef CONFIG_COLLECT_SCHEDULE_GRAPH
+				edges.emplace_back(&j, &new_s, &next, frange);
+#endif
+				count_edge();
 			}
 
 			void make_initial_state()
 			{
 				// construct initial state
+				add_depth();
+				new_state(num_cpus, *nothing_dispatched);
+			}
+
+			Job_set_pool& job_sets()
+			{
+				return job_set_pools.back();
+			}
+
+			Arena* depth_arena()
+			{
+				return use_arenas ? &arenas.back() : nullptr;
+			}
+
+			// allocate space for the states of the next depth
+			void add_depth()
+			{
+				arenas.emplace_back();
 				states_storage.emplace_back();
-				new_state(num_cpus);
+				job_set_pools.emplace_back(depth_arena());
+			}
+
+			void track_arena_memory()
+			{
+				std::size_t n = 0;
+				for (const Arena& a : arenas)
+					n += a.bytes_reserved();
+				arena_high_water = std::max(arena_high_water, n);
+			}
+
+			// release the oldest depth and everything allocated for it
+			void drop_depth()
+			{
+				track_arena_memory();
+#ifdef CONFIG_PARALLEL
+				parallel_for(states_storage.front().range(),
+					[] (typename Split_states::range_type& r) {
+						for (auto it = r.begin(); it != r.end(); it++)
+							it->clear();
+					});
+#endif
+				states_storage.pop_front();
+				job_set_pools.pop_front();
+				arenas.pop_front();
 			}
 
 			States& states()
@@ -446,7 +650,30 @@ namespace NP {
 				return *s;
 			}
 
-#ifdef CONFIG_PARALLEL
+#if defined(CONFIG_PARALLEL) && defined(CONFIG_SHARDED_STATE_CACHE)
+
+			// returns the state into which s was merged, or s itself
+			// if it was cached instead
+			State_ref merge_or_cache(State_ref s)
+			{
+				return states_by_key.with_entry(s->get_key(),
+					[&] (State_refs& list) {
+						for (State_ref other : list) {
+							if (!other->same_jobs_scheduled(*s)) {
+								count_key_collision();
+								continue;
+							}
+							if (other->try_to_merge(*s))
+								return other;
+						}
+						// If we reach here, we failed to merge, so go ahead
+						// and insert it.
+						list.push_front(s);
+						return s;
+					});
+			}
+
+#elif defined(CONFIG_PARALLEL)
 
 			// make state available for fast lookup
 			void insert_cache_state(States_map_accessor &acc, State_ref s)
@@ -465,9 +692,14 @@ namespace NP {
 				while (true) {
 					// check if key exists
 					if (states_by_key.find(acc, s->get_key())) {
-						for (State_ref other : acc->second)
+						for (State_ref other : acc->second) {
+							if (!other->same_jobs_scheduled(*s)) {
+								count_key_collision();
+								continue;
+							}
 							if (other->try_to_merge(*s))
 								return other;
+						}
 						// If we reach here, we failed to merge, so go ahead
 						// and insert it.
 						insert_cache_state(acc, s);
@@ -484,35 +716,36 @@ namespace NP {
 
 #else
 
-			void cache_state(State_ref s)
+			State_ref merge_or_cache(State_ref s)
 			{
-				// create a new list if needed, or lookup if already existing
-				auto res = states_by_key.emplace(
-					std::make_pair(s->get_key(), State_refs()));
-
-				auto pair_it = res.first;
-				State_refs& list = pair_it->second;
-
-				list.push_front(s);
+				return merge_or_cache(states_by_key, s, num_key_collisions);
 			}
 
+#endif
 
-			State_ref merge_or_cache(State_ref s_ref)
+			// returns the state in the given (unsynchronized) cache into
+			// which s was merged, or s itself if it was cached instead
+			static State_ref merge_or_cache(Local_states_map& cache,
+			                                State_ref s_ref,
+			                                unsigned long& collisions)
 			{
 				State& s = *s_ref;
 
-				const auto pair_it = states_by_key.find(s.get_key());
+				// create a new list if needed, or lookup if already existing
+				State_refs& list = cache[s.get_key()];
 
-				// cannot merge if key doesn't exist
-				if (pair_it != states_by_key.end())
-					for (State_ref other : pair_it->second)
-						if (other->try_to_merge(*s_ref))
-							return other;
+				for (State_ref other : list) {
+					if (!other->same_jobs_scheduled(s)) {
+						collisions++;
+						continue;
+					}
+					if (other->try_to_merge(s))
+						return other;
+				}
 				// if we reach here, we failed to merge
-				cache_state(s_ref);
+				list.push_front(s_ref);
 				return s_ref;
 			}
-#endif
 
 			void check_cpu_timeout()
 			{
@@ -535,7 +768,7 @@ namespace NP {
 
 			bool ready(const State& s, const Job<Time>& j) const
 			{
-				return unfinished(s, j) && s.job_ready(predecessors_of(j));
+				return s.job_ready(index_of(j));
 			}
 
 			bool all_jobs_scheduled(const State& s) const
@@ -550,7 +783,7 @@ namespace NP {
 				for (auto pred : predecessors_of(j)) {
 					Interval<Time> ft{0, 0};
 					if (!s.get_finish_times(pred, ft))
-						ft = get_finish_times(jobs[pred]);
+						ft = finish_times_of(pred);
 					r.lower_bound(ft.min());
 					r.extend_to(ft.max());
 				}
@@ -569,7 +802,7 @@ namespace NP {
 						continue;
 					Interval<Time> ft{0, 0};
 					if (!s.get_finish_times(pred, ft))
-						ft = get_finish_times(jobs[pred]);
+						ft = finish_times_of(pred);
 					r.lower_bound(ft.min());
 					r.extend_to(ft.max());
 				}
@@ -602,14 +835,21 @@ namespace NP {
 				const Time t_earliest) const
 			{
 				auto ready_min = earliest_ready_time(s, reference_job);
-				Time when = Time_model::constants<Time>::infinity();
-
-				// check everything that overlaps with t_earliest
-				for (const Job<Time>& j : jobs_by_win.lookup(t_earliest))
-					if (ready(s, j)
-					    && j.higher_priority_than(reference_job)) {
+				auto b = jobs_by_win.bucket_of(t_earliest);
+
+				// check everything that overlaps with t_earliest: the jobs
+				// without predecessors are ready once they have arrived...
+				Time when = independent_jobs_by_win[b].min_latest_arrival(
+					s.get_scheduled_jobs(),
+					job_table.rank(index_of(reference_job)));
+				when = std::max(when, ready_min);
+
+				// ... and the others depend on their predecessors
+				for (const Job<Time>* j : dependent_jobs_by_win[b])
+					if (ready(s, *j)
+					    && j->higher_priority_than(reference_job)) {
 						when = std::min(when,
-							latest_ready_time(s, ready_min, j, reference_job));
+							latest_ready_time(s, ready_min, *j, reference_job));
 					}
 
 				// No point looking in the future when we've already
@@ -643,12 +883,15 @@ namespace NP {
 			// Note that this time may be in the past.
 			Time next_job_ready(const State& s, const Time t_earliest) const
 			{
-				Time when = Time_model::constants<Time>::infinity();
+				auto b = jobs_by_win.bucket_of(t_earliest);
 
 				// check everything that overlaps with t_earliest
-				for (const Job<Time>& j : jobs_by_win.lookup(t_earliest))
-					if (ready(s, j))
-						when = std::min(when, latest_ready_time(s, j));
+				Time when = independent_jobs_by_win[b].min_latest_arrival(
+					s.get_scheduled_jobs());
+
+				for (const Job<Time>* j : dependent_jobs_by_win[b])
+					if (ready(s, *j))
+						when = std::min(when, latest_ready_time(s, *j));
 
 				// No point looking in the future when we've already
 				// found one in the present.
@@ -717,9 +960,11 @@ namespace NP {
 				// expand the graph, merging if possible
 				const State& next = be_naive ?
 					new_state(s, index_of(j), predecessors_of(j),
-					          st, ftimes, j.get_key()) :
+					          st, ftimes, job_key(j), job_sets(),
+					          depth_arena()) :
 					new_or_merged_state(s, index_of(j), predecessors_of(j),
-					                    st, ftimes, j.get_key());
+					                    st, ftimes, job_key(j), job_sets(),
+					                    depth_arena());
 
 				// make sure we didn't skip any jobs
 				check_for_deadline_misses(s, next);
@@ -732,7 +977,13 @@ namespace NP {
 				return true;
 			}
 
-			void explore(const State& s)
+			// Calls dispatch(j, t_wc) for each job j that might be scheduled
+			// next in state s, in the order in which explore(s) considers
+			// them. Returns true if at least one call returned true (i.e.,
+			// if j actually had a feasible start-time interval).
+			template <typename Dispatch>
+			bool foreach_possible_successor(const State& s,
+			                                Dispatch dispatch) const
 			{
 				bool found_one = false;
 
@@ -760,7 +1011,7 @@ namespace NP {
 				// (1) first check jobs that may be already pending
 				for (const Job<Time>& j : jobs_by_win.lookup(t_min))
 					if (j.earliest_arrival() <= t_min && ready(s, j))
-						found_one |= dispatch(s, j, t_wc);
+						found_one |= dispatch(j, t_wc);
 
 				DM("==== [2] ====" << std::endl);
 				// (2) check jobs that are released only later in the interval
@@ -781,12 +1032,28 @@ namespace NP {
 					// be incomplete...
 					assert(unfinished(s, j));
 
-					found_one |= dispatch(s, j, t_wc);
+					found_one |= dispatch(j, t_wc);
 				}
 
+				return found_one;
+			}
+
+			// true if s is a dead end, i.e., we are out of options but
+			// didn't schedule all jobs
+			bool is_dead_end(const State& s, bool found_successor) const
+			{
+				return !found_successor && !all_jobs_scheduled(s);
+			}
+
+			void explore(const State& s)
+			{
+				bool found_one = foreach_possible_successor(s,
+					[&] (const Job<Time>& j, Time t_wc) {
+						return dispatch(s, j, t_wc);
+					});
+
 				// check for a dead end
-				if (!found_one && !all_jobs_scheduled(s))
-					// out of options and we didn't schedule all jobs
+				if (is_dead_end(s, found_one))
 					aborted = true;
 			}
 
@@ -802,20 +1069,15 @@ namespace NP {
 				make_initial_state();
 
 				while (current_job_count < jobs.size()) {
-					unsigned long n;
+					unsigned long n = newest_depth_size();
 #ifdef CONFIG_PARALLEL
 					const auto& new_states_part = states_storage.back();
-					n = 0;
-					for (const States& new_states : new_states_part) {
-						n += new_states.size();
-					}
 #else
 					States& exploration_front = states();
-					n = exploration_front.size();
 #endif
 
 					// allocate states space for next depth
-					states_storage.emplace_back();
+					add_depth();
 
 					// keep track of exploration front width
 					width = std::max(width, n);
@@ -851,56 +1113,409 @@ namespace NP {
 					}
 #endif
 
-					// clean up the state cache if necessary
-					if (!be_naive)
-						states_by_key.clear();
+					finish_depth(!be_naive);
+				}
 
-					current_job_count++;
+				finish_exploration();
+			}
 
+			// number of states in the most recently added depth
+			unsigned long newest_depth_size() const
+			{
 #ifdef CONFIG_PARALLEL
-					// propagate any updates to the response-time estimates
-					for (auto& r : partial_rta)
-						for (const auto& elem : r)
-							update_finish_times(rta, elem.first, elem.second);
+				unsigned long n = 0;
+				for (const States& new_states : states_storage.back())
+					n += new_states.size();
+				return n;
+#else
+				return states_storage.back().size();
 #endif
+			}
+
+			// bookkeeping once all states of the current depth are explored
+			void finish_depth(bool clean_state_cache)
+			{
+				current_job_count++;
 
-#ifndef CONFIG_COLLECT_SCHEDULE_GRAPH
-					// If we don't need to collect all states, we can remove
-					// all those that we are done with, which saves a lot of
-					// memory.
 #ifdef CONFIG_PARALLEL
-					parallel_for(states_storage.front().range(),
-						[] (typename Split_states::range_type& r) {
-							for (auto it = r.begin(); it != r.end(); it++)
-								it->clear();
-						});
-#endif
-					states_storage.pop_front();
+				// Measure the new depth before releasing the explored one,
+				// which modifies states_storage. After that, the three
+				// steps touch disjoint data (the response times, the state
+				// cache, and the oldest depth with its arena), so they can
+				// overlap instead of running one after another.
+				auto n = newest_depth_size();
+				tbb::parallel_invoke(
+					[&] {
+						fold_response_times();
+					},
+					[&] {
+						if (clean_state_cache)
+							prepare_state_cache(n);
+					},
+					[&] {
+						release_explored_depth();
+					});
+#else
+				if (clean_state_cache)
+					prepare_state_cache(newest_depth_size());
+				release_explored_depth();
 #endif
+			}
+
+#ifdef CONFIG_PARALLEL
+			// propagate any updates to the response-time estimates that
+			// are needed to explore the next depth
+			void fold_response_times()
+			{
+				for (auto& updates : pending_rta) {
+					for (const auto& u : updates)
+						rta.update(u.first, u.second);
+					updates.clear();
 				}
+			}
+#endif
 
+			// get the state cache ready for the states of the next depth,
+			// given the number of states in the newest depth
+			void prepare_state_cache(unsigned long width)
+			{
+#if defined(CONFIG_PARALLEL) && defined(CONFIG_SHARDED_STATE_CACHE)
+				// size the state cache for the next depth, assuming it
+				// will be about as wide as the current one
+				states_by_key.reset(width);
+#else
+				(void) width;
+				states_by_key.clear();
+#endif
+			}
 
+			void release_explored_depth()
+			{
 #ifndef CONFIG_COLLECT_SCHEDULE_GRAPH
-				// clean out any remaining states
-				while (!states_storage.empty()) {
-#ifdef CONFIG_PARALLEL
-					parallel_for(states_storage.front().range(),
-						[] (typename Split_states::range_type& r) {
-							for (auto it = r.begin(); it != r.end(); it++)
-								it->clear();
-						});
-#endif
-					states_storage.pop_front();
-				}
+				// If we don't need to collect all states, we can remove
+				// all those that we are done with, which saves a lot of
+				// memory.
+				drop_depth();
 #endif
+			}
 
+			void finish_exploration()
+			{
+#ifndef CONFIG_COLLECT_SCHEDULE_GRAPH
+				// clean out any remaining states
+				while (!states_storage.empty())
+					drop_depth();
+#else
+				track_arena_memory();
+#endif
 
 #ifdef CONFIG_PARALLEL
+				// the response times that were not needed during the
+				// exploration
+				for (const auto& r : partial_rta)
+					rta.merge(r);
+
 				for (auto &c : edge_counter)
 					num_edges += c;
+				for (auto &c : collision_counter)
+					num_key_collisions += c;
+#endif
+			}
+
+#ifdef CONFIG_PARALLEL
+
+			// a transition found in the first phase of
+			// explore_deterministically()
+			struct Successor {
+				const Job<Time>* job;
+				Interval<Time> start_times;
+				Interval<Time> finish_times;
+				hash_value_t key;
+			};
+
+			// the finish-time bounds of a job before the current depth of
+			// explore_deterministically() changed them
+			struct Previous_finish_times {
+				std::size_t job;
+				bool known;
+				Interval<Time> bounds;
+			};
+
+			// Deterministic variant of the parallel explore(). For each
+			// depth, (1) the successors of all states in the exploration
+			// front are determined in parallel, and then (2) the new states
+			// are created and merged in parallel over disjoint shards of the
+			// key space. Since states can be merged only if their keys match,
+			// each shard can replay its part of the transitions in exactly
+			// the order in which the sequential explore() processes them,
+			// which yields exactly the same states, edges, and response-time
+			// bounds as a sequential run, no matter how many threads are
+			// used. A depth that ends the exploration (because of a deadline
+			// miss or a dead end) is simply explored again sequentially.
+			//
+			// In a sequential run, each state sees the finish times found
+			// by the states before it in the front. In between (1) and (2),
+			// the finish times are therefore updated in the order of the
+			// front, and the few states that look up a finish time that
+			// has changed in the meantime get their successors determined
+			// again.
+			void explore_deterministically()
+			{
+				const std::size_t num_shards =
+					tbb::this_task_arena::max_concurrency();
+
+				// only this thread updates rta, and only while the workers
+				// are not looking it up
+				immediate_rta = true;
+
+				auto shard_of = [num_shards] (hash_value_t key) {
+					return (std::size_t) (key % num_shards);
+				};
+
+				// the state cache, split by key
+				std::vector<Local_states_map> cache(num_shards);
+				// per-shard statistics
+				std::vector<unsigned long> shard_edges(num_shards);
+				std::vector<unsigned long> shard_collisions(num_shards);
+				// first state of the front that reveals a deadline miss
+				std::vector<std::size_t> shard_miss(num_shards);
+
+				make_initial_state();
+
+				// the exploration front, in the order of explore()
+				std::vector<const State*> front{&states().back()};
+
+				std::vector<std::vector<Successor>> successors;
+				std::vector<char> dead_end, deadline_miss;
+				std::vector<std::size_t> first_edge;
+				std::vector<const State*> created;
+
+				// the jobs whose finish times the current depth updated
+				// (what they were before, and whether they changed and
+				// have successors)
+				std::vector<Previous_finish_times> previous;
+				std::vector<char> updated(jobs.size(), 0), changed(jobs.size(), 0);
+				std::vector<std::size_t> changed_jobs;
+
+				auto find_successors = [&] (std::size_t i) {
+					const State& s = *front[i];
+					std::vector<Successor>& succ = successors[i];
+					succ.clear();
+					deadline_miss[i] = 0;
+					bool found = foreach_possible_successor(s,
+						[&] (const Job<Time>& j, Time t_wc) {
+							auto _st = start_times(s, j, t_wc);
+							if (_st.first > _st.second)
+								return false;
+							Interval<Time> st{_st};
+							Interval<Time> ftimes = st + j.get_cost();
+							if (j.exceeds_deadline(ftimes.upto()))
+								deadline_miss[i] = 1;
+							succ.push_back({&j, st, ftimes,
+								s.get_key() ^ job_key(j)});
+							return true;
+						});
+					dead_end[i] = is_dead_end(s, found);
+				};
+
+				// does the state look up a finish time that has changed
+				// since the depth started?
+				auto sees_changes = [&] (const State& s) {
+					for (auto j : changed_jobs)
+						if (!s.job_incomplete(j))
+							return true;
+					return false;
+				};
+
+				while (current_job_count < jobs.size()) {
+					auto n = front.size();
+
+					// allocate states space for next depth
+					add_depth();
+
+					// keep track of exploration front width
+					width = std::max(width, (unsigned long) n);
+
+					num_states += n;
+
+					check_depth_abort();
+					check_cpu_timeout();
+					if (aborted)
+						break;
+
+					successors.resize(n);
+					dead_end.assign(n, 0);
+					deadline_miss.assign(n, 0);
+
+					// (1) find all successors
+					tbb::parallel_for(tbb::blocked_range<std::size_t>(0, n),
+						[&] (const tbb::blocked_range<std::size_t>& r) {
+							for (auto i = r.begin(); i != r.end(); i++)
+								find_successors(i);
+						});
+
+					// update the finish times in the order of explore(),
+					// up to the first state after which it would stop
+					std::size_t last = n;
+					for (std::size_t i = 0; i < n; i++) {
+						if (sees_changes(*front[i]))
+							find_successors(i);
+						if (dead_end[i] || deadline_miss[i]) {
+							last = i;
+							break;
+						}
+						for (const Successor& succ : successors[i]) {
+							auto j = index_of(*succ.job);
+							if (!updated[j]) {
+								updated[j] = 1;
+								previous.push_back({j, rta.contains(j),
+									rta.contains(j) ? rta[j] : succ.finish_times});
+							}
+							if (rta.update(j, succ.finish_times)
+							    && has_successors(j) && !changed[j]) {
+								changed[j] = 1;
+								changed_jobs.push_back(j);
+							}
+						}
+					}
+
+					if (last == n) {
+						first_edge.resize(n + 1);
+						first_edge[0] = 0;
+						for (std::size_t i = 0; i < n; i++)
+							first_edge[i + 1] = first_edge[i] + successors[i].size();
+						created.assign(first_edge[n], nullptr);
+						shard_miss.assign(num_shards, n);
+
+						// (2) create the new states, merging where possible
+						tbb::parallel_for(
+							tbb::blocked_range<std::size_t>(0, num_shards, 1),
+							[&] (const tbb::blocked_range<std::size_t>& r) {
+								for (auto shard = r.begin(); shard != r.end(); shard++) {
+									for (std::size_t i = 0; i < n; i++)
+										if (!replay_transitions(*front[i],
+										        successors[i], shard, shard_of,
+										        cache[shard],
+										        created.data() + first_edge[i],
+										        shard_edges[shard],
+										        shard_collisions[shard])) {
+											shard_miss[shard] = i;
+											break;
+										}
+									cache[shard].clear();
+								}
+							});
+
+						last = *std::min_element(shard_miss.begin(),
+						                         shard_miss.end());
+					}
+
+					if (last == n) {
+						// propagate statistics
+						for (std::size_t shard = 0; shard < num_shards; shard++) {
+							num_edges += shard_edges[shard];
+							num_key_collisions += shard_collisions[shard];
+						}
+
+						// the new front, in the order in which explore()
+						// would have created the states
+						front.clear();
+						for (const State* s : created)
+							if (s)
+								front.push_back(s);
+					} else {
+						// Somewhere in this depth, explore() would have
+						// stopped. Throw away what we found and let it
+						// explore the depth, so that it stops at exactly the
+						// same point.
+						for (States& new_states : states_storage.back())
+							new_states.clear();
+
+						for (const auto& p : previous)
+							if (p.known)
+								rta.reset(p.job, p.bounds);
+							else
+								rta.reset(p.job);
+
+#ifdef CONFIG_SHARDED_STATE_CACHE
+						if (!be_naive)
+							states_by_key.reset(n);
+#endif
+						for (std::size_t i = 0; i < n && !aborted; i++)
+							explore(*front[i]);
+
+#ifndef CONFIG_SHARDED_STATE_CACHE
+						if (!be_naive)
+							states_by_key.clear();
 #endif
+
+						front.clear();
+						for (const States& new_states : states_storage.back())
+							for (const State& s : new_states)
+								front.push_back(&s);
+					}
+
+					for (std::size_t shard = 0; shard < num_shards; shard++)
+						shard_edges[shard] = shard_collisions[shard] = 0;
+
+					for (const auto& p : previous)
+						updated[p.job] = changed[p.job] = 0;
+					previous.clear();
+					changed_jobs.clear();
+
+					finish_depth(false);
+				}
+
+				finish_exploration();
+			}
+
+			// the part of explore(s) that concerns the given shard; returns
+			// false if it reveals a deadline miss
+			template<typename Shard_of>
+			bool replay_transitions(
+				const State& s,
+				const std::vector<Successor>& successors,
+				std::size_t shard,
+				Shard_of shard_of,
+				Local_states_map& cache,
+				const State** created,
+				unsigned long& edges,
+				unsigned long& collisions)
+			{
+				for (const Successor& succ : successors) {
+					if (shard_of(succ.key) != shard) {
+						created++;
+						continue;
+					}
+
+					const Job<Time>& j = *succ.job;
+
+					// expand the graph, merging if possible
+					State_ref next =
+						alloc_state(s, index_of(j), predecessors_of(j),
+						            succ.start_times, succ.finish_times,
+						            job_key(j), job_sets(), depth_arena());
+					if (!be_naive) {
+						State_ref found = merge_or_cache(cache, next, collisions);
+						if (found != next) {
+							dealloc_state(next);
+							next = found;
+						} else
+							*created = &*next;
+					} else
+						*created = &*next;
+					created++;
+
+					edges++;
+
+					// make sure we didn't skip any jobs
+					if (skipped_deadline_miss(s, *next))
+						return false;
+				}
+				return true;
 			}
 
+#endif
 
 #ifdef CONFIG_COLLECT_SCHEDULE_GRAPH
 			friend std::ostream& operator<< (std::ostream& out,
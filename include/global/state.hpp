@@ -4,9 +4,14 @@
 #include <algorithm>
 
 #include <set>
+#include <memory>
+#include <new>
+#include <type_traits>
 
 #include "util.hpp"
 #include "index_set.hpp"
+#include "index_set_pool.hpp"
+#include "arena.hpp"
 #include "jobs.hpp"
 #include "cache.hpp"
 
@@ -16,32 +21,140 @@ namespace NP {
 
 		typedef std::size_t Job_index;
 		typedef std::vector<Job_index> Job_precedence_set;
+		typedef Job_index_set Job_set;
+
+		// the precedence constraints of a workload, by job index
+		struct Job_dependencies
+		{
+			// the immediate predecessors of each job...
+			std::vector<Job_precedence_set> predecessors;
+			// ... and its immediate successors
+			std::vector<Job_precedence_set> successors;
+
+			Job_dependencies(std::size_t num_jobs = 0)
+			: predecessors(num_jobs)
+			, successors(num_jobs)
+			{
+			}
+		};
+
+		// The set of jobs that have been dispatched in a state, together
+		// with the set of jobs that cannot be dispatched yet because some
+		// of their predecessors have not been dispatched. Both are
+		// interned together (see Index_set_pool), so the blocked jobs are
+		// derived only once per distinct set of dispatched jobs: only the
+		// successors of the newly dispatched job can become unblocked.
+		class Dispatched_jobs
+		{
+			public:
+
+			// nothing dispatched, no precedence constraints
+			Dispatched_jobs()
+			: dependencies(nullptr)
+			{
+			}
+
+			// nothing dispatched, so all jobs with predecessors are blocked
+			Dispatched_jobs(const Job_dependencies& deps)
+			: dependencies(&deps)
+			{
+				for (Job_index k = 0; k < deps.predecessors.size(); k++)
+					if (!deps.predecessors[k].empty())
+						blocked.add(k);
+			}
+
+			// derive a new set by additionally dispatching job j
+			// (optionally allocated from the given arena)
+			Dispatched_jobs(const Dispatched_jobs& from, Job_index j,
+			                Arena* arena = nullptr)
+			: dispatched(from.dispatched, j, arena)
+			, blocked(from.blocked, arena)
+			, dependencies(from.dependencies)
+			{
+				if (dependencies)
+					for (auto k : dependencies->successors[j])
+						if (dispatched.includes(dependencies->predecessors[k]))
+							blocked.remove(k);
+			}
+
+			// check whether this set is equal to the set {from, j}
+			bool equals_with(const Dispatched_jobs& from, Job_index j) const
+			{
+				return dispatched.equals_with(from.dispatched, j);
+			}
+
+			const Job_set& jobs() const
+			{
+				return dispatched;
+			}
+
+			bool contains(Job_index j) const
+			{
+				return dispatched.contains(j);
+			}
+
+			// j has not been dispatched, but all its predecessors have
+			bool ready(Job_index j) const
+			{
+				return !dispatched.contains(j) && !blocked.contains(j);
+			}
+
+			private:
+
+			Job_set dispatched;
+			Job_set blocked;
+			const Job_dependencies* dependencies;
+
+			// no accidental copies
+			Dispatched_jobs(const Dispatched_jobs& origin) = delete;
+		};
+
+		typedef Index_set_pool<Dispatched_jobs> Job_set_pool;
 
 		template<class Time> class Schedule_state
 		{
 			public:
 
 			// initial state -- nothing yet has finished, nothing is running
-			Schedule_state(unsigned int num_processors)
-			: scheduled_jobs()
+			Schedule_state(unsigned int num_processors,
+			               const Dispatched_jobs& nothing_dispatched =
+			                   empty_index_set<Dispatched_jobs>())
+			: scheduled_jobs(&nothing_dispatched)
 			, num_jobs_scheduled(0)
-			, core_avail{num_processors, Interval<Time>(Time(0), Time(0))}
+			, num_cores(num_processors)
+			, num_certain_jobs(0)
+			, certain_jobs_capacity(0)
+			, storage(allocate(num_processors, 0))
 			, lookup_key{0x9a9a9a9a9a9a9a9aUL}
 			{
-				assert(core_avail.size() > 0);
+				assert(num_cores > 0);
+				std::fill(core_min(), core_min() + num_cores, Time(0));
+				std::fill(core_max(), core_max() + num_cores, Time(0));
 			}
 
 			// transition: new state by scheduling a job in an existing state,
 			//             by replacing a given running job.
+			//             The set of scheduled jobs is obtained from the
+			//             given pool (and hence shared with all other
+			//             states in the pool that scheduled the same jobs).
+			//             If an arena is given, the state's storage is
+			//             allocated from it.
 			Schedule_state(
 				const Schedule_state& from,
 				Job_index j,
 				const Job_precedence_set& predecessors,
 				Interval<Time> start_times,
 				Interval<Time> finish_times,
-				hash_value_t key)
+				hash_value_t key,
+				Job_set_pool& pool,
+				Arena* arena = nullptr)
 			: num_jobs_scheduled(from.num_jobs_scheduled + 1)
-			, scheduled_jobs{from.scheduled_jobs, j}
+			, scheduled_jobs{&pool.intern(*from.scheduled_jobs, j,
+			                              from.lookup_key ^ key)}
+			, num_cores(from.num_cores)
+			, num_certain_jobs(0)
+			, certain_jobs_capacity(from.num_certain_jobs + 1)
+			, storage(allocate(num_cores, certain_jobs_capacity, arena))
 			, lookup_key{from.lookup_key ^ key}
 			{
 				auto est = start_times.min();
@@ -54,54 +167,62 @@ namespace NP {
 				<< "eft: " << eft << std::endl
 				<< "lft: " << lft << std::endl);
 
-				std::vector<Time> ca, pa;
-
-				pa.push_back(eft);
-				ca.push_back(lft);
+				Time* pa = core_min();
+				Time* ca = core_max();
 
-				// skip first element in from.core_avail
-				for (int i = 1; i < from.core_avail.size(); i++) {
-					pa.push_back(std::max(est, from.core_avail[i].min()));
-					ca.push_back(std::max(est, from.core_avail[i].max()));
+				// skip first element in from.core_avail; the rest is
+				// already sorted and stays sorted
+				for (unsigned int i = 1; i < num_cores; i++) {
+					pa[i - 1] = std::max(est, from.core_min()[i]);
+					ca[i - 1] = std::max(est, from.core_max()[i]);
 				}
+				// insert the core that j occupies at the right place
+				insert_sorted(pa, num_cores - 1, eft);
+				insert_sorted(ca, num_cores - 1, lft);
 
 				// update scheduled jobs
 				// keep it sorted to make it easier to merge
 				bool added_j = false;
-				for (const auto& rj : from.certain_jobs) {
+				for (const auto& rj : from.certain_jobs_range()) {
 					auto x = rj.first;
 					auto x_eft = rj.second.min();
 					auto x_lft = rj.second.max();
 					if (contains(predecessors, x)) {
 						if (lst < x_lft) {
-							auto pos = std::find(ca.begin(), ca.end(), x_lft);
-							if (pos != ca.end())
+							// the core that x occupies becomes available
+							// for j's successors once j starts
+							auto pos = std::lower_bound(ca, ca + num_cores,
+							                            x_lft);
+							if (pos != ca + num_cores && *pos == x_lft) {
 								*pos = lst;
+								// lst < x_lft, so move it to the left
+								for (; pos != ca && *(pos - 1) > *pos; pos--)
+									std::swap(*pos, *(pos - 1));
+							}
 						}
 					} else if (lst <= x_eft) {
 						if (!added_j && rj.first > j) {
 							// right place to add j
-							certain_jobs.emplace_back(j, finish_times);
+							add_certain_job(j, finish_times);
 							added_j = true;
 						}
-						certain_jobs.emplace_back(rj);
+						add_certain_job(rj.first, rj.second);
 					}
 				}
 				// if we didn't add it yet, add it at the back
 				if (!added_j)
-					certain_jobs.emplace_back(j, finish_times);
-
-
-				// sort in non-decreasing order
-				std::sort(pa.begin(), pa.end());
-				std::sort(ca.begin(), ca.end());
+					add_certain_job(j, finish_times);
 
-				for (int i = 0; i < from.core_avail.size(); i++) {
+				// Both sequences are sorted in non-decreasing order, but
+				// pairing them up could still yield inverted intervals, which
+				// we normalize (as the Interval constructor would).
+				for (unsigned int i = 0; i < num_cores; i++) {
 					DM(i << " -> " << pa[i] << ":" << ca[i] << std::endl);
-					core_avail.emplace_back(pa[i], ca[i]);
+					if (pa[i] > ca[i])
+						std::swap(pa[i], ca[i]);
 				}
 
-				assert(core_avail.size() > 0);
+				assert(num_cores > 0);
 				DM("*** new state: constructed " << *this << std::endl);
 			}
 
@@ -110,6 +231,8 @@ namespace NP {
 				return lookup_key;
 			}
 
+			// NOTE: assumes that both states obtained their job sets
+			//       from the same pool
 			bool same_jobs_scheduled(const Schedule_state &other) const
 			{
 				return scheduled_jobs == other.scheduled_jobs;
@@ -117,14 +240,14 @@ namespace NP {
 
 			bool can_merge_with(const Schedule_state<Time>& other) const
 			{
-				assert(core_avail.size() == other.core_avail.size());
+				assert(num_cores == other.num_cores);
 
 				if (get_key() != other.get_key())
 					return false;
 				if (!same_jobs_scheduled(other))
 					return false;
-				for (int i = 0; i < core_avail.size(); i++)
-					if (!core_avail[i].intersects(other.core_avail[i]))
+				for (unsigned int i = 0; i < num_cores; i++)
+					if (!core_avail(i).intersects(other.core_avail(i)))
 						return false;
 				return true;
 			}
@@ -134,20 +257,23 @@ namespace NP {
 				if (!can_merge_with(other))
 					return false;
 
-				for (int i = 0; i < core_avail.size(); i++)
-					core_avail[i] |= other.core_avail[i];
-
-				// vector to collect joint certain jobs
-				std::vector<std::pair<Job_index, Interval<Time>>> new_cj;
+				for (unsigned int i = 0; i < num_cores; i++) {
+					core_min()[i] = std::min(core_min()[i], other.core_min()[i]);
+					core_max()[i] = std::max(core_max()[i], other.core_max()[i]);
+				}
 
-				// walk both sorted job lists to see if we find matches
-				auto it = certain_jobs.begin();
-				auto jt = other.certain_jobs.begin();
-				while (it != certain_jobs.end() &&
-				       jt != other.certain_jobs.end()) {
+				// Walk both sorted job lists to see if we find matches.
+				// The joint certain jobs are a subset of ours, so we can
+				// collect them in place.
+				auto it = certain_jobs();
+				auto it_end = certain_jobs() + num_certain_jobs;
+				auto jt = other.certain_jobs();
+				auto jt_end = other.certain_jobs() + other.num_certain_jobs;
+				auto out = certain_jobs();
+				while (it != it_end && jt != jt_end) {
 					if (it->first == jt->first) {
 						// same job
-						new_cj.emplace_back(it->first, it->second | jt->second);
+						*out++ = Certain_job(it->first, it->second | jt->second);
 						it++;
 						jt++;
 					} else if (it->first < jt->first)
@@ -155,8 +281,7 @@ namespace NP {
 					else
 						jt++;
 				}
-				// move new certain jobs into the state
-				certain_jobs.swap(new_cj);
+				num_certain_jobs = out - certain_jobs();
 
 				DM("+++ merged " << other << " into " << *this << std::endl);
 
@@ -168,53 +293,59 @@ namespace NP {
 				return num_jobs_scheduled;
 			}
 
+			const Job_set& get_scheduled_jobs() const
+			{
+				return scheduled_jobs->jobs();
+			}
+
 			Interval<Time> core_availability() const
 			{
-				assert(core_avail.size() > 0);
-				return core_avail[0];
+				assert(num_cores > 0);
+				return core_avail(0);
 			}
 
 			bool get_finish_times(Job_index j, Interval<Time> &ftimes) const
 			{
-				for (const auto& rj : certain_jobs) {
-					// check index
-					if (j == rj.first) {
-						ftimes = rj.second;
-						return true;
-					}
-					// Certain_jobs is sorted in order of increasing job index.
-					// If we see something larger than 'j' we are not going
-					// to find it. For large processor counts, it might make
-					// sense to do a binary search instead.
-					if (j < rj.first)
-						return false;
+				// Certain_jobs is sorted in order of increasing job index,
+				// and there can be as many of them as there are cores.
+				auto range = certain_jobs_range();
+				// most lookups are for jobs that finished long ago
+				if (range.begin() == range.end() || j < range.begin()->first
+				    || (range.end() - 1)->first < j)
+					return false;
+				auto it = std::lower_bound(range.begin(), range.end(), j,
+					[] (const Certain_job& rj, Job_index j) {
+						return rj.first < j;
+					});
+				if (it != range.end() && it->first == j) {
+					ftimes = it->second;
+					return true;
 				}
 				return false;
 			}
 
 			const bool job_incomplete(Job_index j) const
 			{
-				return !scheduled_jobs.contains(j);
+				return !scheduled_jobs->contains(j);
 			}
 
-			const bool job_ready(const Job_precedence_set& predecessors) const
+			// j is incomplete and all its predecessors have been dispatched
+			const bool job_ready(Job_index j) const
 			{
-				for (auto j : predecessors)
-					if (!scheduled_jobs.contains(j))
-						return false;
-				return true;
+				return scheduled_jobs->ready(j);
 			}
 
 			friend std::ostream& operator<< (std::ostream& stream,
 			                                 const Schedule_state<Time>& s)
 			{
 				stream << "Global::State(";
-				for (const auto& a : s.core_avail)
-					stream << "[" << a.from() << ", " << a.until() << "] ";
+				for (unsigned int i = 0; i < s.num_cores; i++)
+					stream << "[" << s.core_min()[i] << ", "
+					       << s.core_max()[i] << "] ";
 				stream << "(";
-				for (const auto& rj : s.certain_jobs)
+				for (const auto& rj : s.certain_jobs_range())
 					stream << rj.first << "";
-				stream << ") " << s.scheduled_jobs << ")";
+				stream << ") " << s.get_scheduled_jobs() << ")";
 				stream << " @ " << &s;
 				return stream;
 			}
@@ -222,12 +353,13 @@ namespace NP {
 			void print_vertex_label(std::ostream& out,
 				const typename Job<Time>::Job_set& jobs) const
 			{
-				for (const auto& a : core_avail)
-					out << "[" << a.from() << ", " << a.until() << "] ";
+				for (unsigned int i = 0; i < num_cores; i++)
+					out << "[" << core_min()[i] << ", "
+					    << core_max()[i] << "] ";
 				out << "\\n";
 				bool first = true;
 				out << "{";
-				for (const auto& rj : certain_jobs) {
+				for (const auto& rj : certain_jobs_range()) {
 					if (!first)
 						out << ", ";
 					out << "T" << jobs[rj.first].get_task_id()
@@ -242,17 +374,107 @@ namespace NP {
 
 			const unsigned int num_jobs_scheduled;
 
-			// set of jobs that have been dispatched (may still be running)
-			const Index_set scheduled_jobs;
-
-			// imprecise set of certainly running jobs
-			std::vector<std::pair<Job_index, Interval<Time>>> certain_jobs;
+			// set of jobs that have been dispatched (may still be running),
+			// shared with all other states that dispatched the same jobs
+			const Dispatched_jobs* const scheduled_jobs;
+
+			typedef std::pair<Job_index, Interval<Time>> Certain_job;
+
+			const unsigned int num_cores;
+			unsigned int num_certain_jobs;
+			const unsigned int certain_jobs_capacity;
+
+			// A single heap block that holds
+			//   (1) the imprecise set of certainly running jobs
+			//       (certain_jobs_capacity slots, sorted by job index),
+			//   (2) the lower bounds of the system availability intervals
+			//       (num_cores entries, sorted), and
+			//   (3) the upper bounds of the system availability intervals
+			//       (num_cores entries, sorted).
+			// The certain jobs go first since their alignment requirement
+			// is at least that of Time.
+			struct Storage_deleter {
+				Arena* arena;
+				std::size_t bytes;
+
+				void operator()(char* p) const
+				{
+					if (arena)
+						arena->deallocate(p, bytes);
+					else
+						delete[] p;
+				}
+			};
 
-			// system availability intervals
-			std::vector<Interval<Time>> core_avail;
+			std::unique_ptr<char[], Storage_deleter> storage;
 
 			const hash_value_t lookup_key;
 
+			static_assert(std::is_trivially_destructible<Certain_job>::value,
+			              "certain jobs are never destroyed explicitly");
+
+			static std::unique_ptr<char[], Storage_deleter> allocate(
+				unsigned int cores, unsigned int capacity,
+				Arena* arena = nullptr)
+			{
+				std::size_t bytes = capacity * sizeof(Certain_job)
+				                    + 2 * cores * sizeof(Time);
+				char* p = arena ?
+					static_cast<char*>(arena->allocate(bytes,
+					                                   alignof(Certain_job))) :
+					new char[bytes];
+				return {p, Storage_deleter{arena, bytes}};
+			}
+
+			Certain_job* certain_jobs() const
+			{
+				return reinterpret_cast<Certain_job*>(storage.get());
+			}
+
+			Time* core_min() const
+			{
+				return reinterpret_cast<Time*>(
+					storage.get() + certain_jobs_capacity * sizeof(Certain_job));
+			}
+
+			Time* core_max() const
+			{
+				return core_min() + num_cores;
+			}
+
+			Interval<Time> core_avail(unsigned int i) const
+			{
+				return Interval<Time>{core_min()[i], core_max()[i]};
+			}
+
+			struct Certain_jobs_range {
+				const Certain_job* first;
+				const Certain_job* last;
+				const Certain_job* begin() const { return first; }
+				const Certain_job* end() const { return last; }
+			};
+
+			Certain_jobs_range certain_jobs_range() const
+			{
+				return {certain_jobs(), certain_jobs() + num_certain_jobs};
+			}
+
+			void add_certain_job(Job_index j, const Interval<Time>& ftimes)
+			{
+				assert(num_certain_jobs < certain_jobs_capacity);
+				new (certain_jobs() + num_certain_jobs) Certain_job(j, ftimes);
+				num_certain_jobs++;
+			}
+
+			// insert x into the sorted array a[0..n-1] (with room for n+1)
+			static void insert_sorted(Time* a, unsigned int n, Time x)
+			{
+				unsigned int i = n;
+				for (; i > 0 && a[i - 1] > x; i--)
+					a[i] = a[i - 1];
+				a[i] = x;
+			}
+
 			// no accidental copies
 			Schedule_state(const Schedule_state& origin)  = delete;
 		};
@@ -1,25 +1,43 @@
 #ifndef INDEX_SET_H
 #define INDEX_SET_H
 
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <ostream>
+
+#include "arena.hpp"
+
 namespace NP {
 
 		class Index_set
 		{
 			public:
 
-			typedef std::vector<bool> Set_type;
+			typedef std::vector<bool, Arena_allocator<bool>> Set_type;
 
 			// new empty job set
 			Index_set() : the_set() {}
 
 			// derive a new set by "cloning" an existing set and adding an index
-			Index_set(const Index_set& from, std::size_t idx)
-			: the_set(std::max(from.the_set.size(), idx + 1))
+			// (optionally allocated from the given arena)
+			Index_set(const Index_set& from, std::size_t idx,
+			          Arena* arena = nullptr)
+			: the_set(std::max(from.the_set.size(), idx + 1), false,
+			          Set_type::allocator_type(arena))
 			{
 				std::copy(from.the_set.begin(), from.the_set.end(), the_set.begin());
 				the_set[idx] = true;
 			}
 
+			// a copy of an existing set (optionally allocated from the
+			// given arena)
+			Index_set(const Index_set& from, Arena* arena)
+			: the_set(from.the_set.begin(), from.the_set.end(),
+			          Set_type::allocator_type(arena))
+			{
+			}
+
 			// create the diff of two job sets (intended for debugging only)
 			Index_set(const Index_set &a, const Index_set &b)
 			: the_set(std::max(a.the_set.size(), b.the_set.size()), true)
@@ -44,7 +62,19 @@ namespace NP {
 				return the_set.size() > idx && the_set[idx];
 			}
 
-			bool includes(std::vector<std::size_t> indices) const
+			// check whether this set is equal to the set {from, idx}
+			// without actually creating the latter
+			bool equals_with(const Index_set& from, std::size_t idx) const
+			{
+				auto n = std::max(std::max(the_set.size(), from.the_set.size()),
+				                  idx + 1);
+				for (std::size_t i = 0; i < n; i++)
+					if (contains(i) != (i == idx || from.contains(i)))
+						return false;
+				return true;
+			}
+
+			bool includes(const std::vector<std::size_t>& indices) const
 			{
 				for (auto i : indices)
 					if (!contains(i))
@@ -76,6 +106,12 @@ namespace NP {
 				the_set[idx] = true;
 			}
 
+			void remove(std::size_t idx)
+			{
+				if (idx < the_set.size())
+					the_set[idx] = false;
+			}
+
 			friend std::ostream& operator<< (std::ostream& stream,
 			                                 const Index_set& s)
 			{
@@ -100,6 +136,191 @@ namespace NP {
 			// no accidental copies
 			Index_set(const Index_set& origin) = delete;
 		};
+
+		// Same interface as Index_set, but the bits are packed into 64-bit
+		// words so that cloning, comparing, and counting work a word at a
+		// time instead of bit by bit.
+		class Packed_index_set
+		{
+			public:
+
+			typedef std::uint64_t Word;
+			typedef std::vector<Word, Arena_allocator<Word>> Set_type;
+
+			static const std::size_t bits_per_word = 64;
+
+			// new empty job set
+			Packed_index_set() : the_set() {}
+
+			// derive a new set by "cloning" an existing set and adding an index
+			// (optionally allocated from the given arena)
+			Packed_index_set(const Packed_index_set& from, std::size_t idx,
+			                 Arena* arena = nullptr)
+			: the_set(Set_type::allocator_type(arena))
+			{
+				auto n = std::max(from.the_set.size(), word_of(idx) + 1);
+				the_set.reserve(n);
+				// one bulk copy of the existing words
+				the_set.assign(from.the_set.begin(), from.the_set.end());
+				the_set.resize(n, 0);
+				the_set[word_of(idx)] |= mask_of(idx);
+			}
+
+			// a copy of an existing set (optionally allocated from the
+			// given arena)
+			Packed_index_set(const Packed_index_set& from, Arena* arena)
+			: the_set(from.the_set.begin(), from.the_set.end(),
+			          Set_type::allocator_type(arena))
+			{
+			}
+
+			// create the diff of two job sets (intended for debugging only)
+			Packed_index_set(const Packed_index_set &a, const Packed_index_set &b)
+			: the_set(std::max(a.the_set.size(), b.the_set.size()), 0)
+			{
+				for (std::size_t i = 0; i < the_set.size(); i++)
+					the_set[i] = a.word(i) ^ b.word(i);
+			}
+
+			bool operator==(const Packed_index_set &other) const
+			{
+				// trailing zero words do not matter
+				auto n = std::max(the_set.size(), other.the_set.size());
+				for (std::size_t i = 0; i < n; i++)
+					if (word(i) != other.word(i))
+						return false;
+				return true;
+			}
+
+			bool operator!=(const Packed_index_set &other) const
+			{
+				return !(*this == other);
+			}
+
+			bool contains(std::size_t idx) const
+			{
+				return word(word_of(idx)) & mask_of(idx);
+			}
+
+			// check whether this set is equal to the set {from, idx}
+			// without actually creating the latter
+			bool equals_with(const Packed_index_set& from, std::size_t idx) const
+			{
+				auto wi = word_of(idx);
+				auto n = std::max(std::max(the_set.size(), from.the_set.size()),
+				                  wi + 1);
+				for (std::size_t i = 0; i < n; i++) {
+					Word expected = from.word(i) | (i == wi ? mask_of(idx) : 0);
+					if (word(i) != expected)
+						return false;
+				}
+				return true;
+			}
+
+			bool includes(const std::vector<std::size_t>& indices) const
+			{
+				for (auto i : indices)
+					if (!contains(i))
+						return false;
+				return true;
+			}
+
+			// O(words) check that all indices in other are in this set
+			bool includes(const Packed_index_set& other) const
+			{
+				return other.is_subset_of(*this);
+			}
+
+			bool is_subset_of(const Packed_index_set& other) const
+			{
+				for (std::size_t i = 0; i < the_set.size(); i++)
+					if (the_set[i] & ~other.word(i))
+						return false;
+				return true;
+			}
+
+			std::size_t size() const
+			{
+				std::size_t count = 0;
+				for (auto w : the_set)
+					count += __builtin_popcountll(w);
+				return count;
+			}
+
+			// raw access to the words (e.g., for vectorized scans);
+			// words at and beyond num_words() are zero
+			const Word* words() const
+			{
+				return the_set.data();
+			}
+
+			std::size_t num_words() const
+			{
+				return the_set.size();
+			}
+
+			void add(std::size_t idx)
+			{
+				if (word_of(idx) >= the_set.size())
+					the_set.resize(word_of(idx) + 1, 0);
+				the_set[word_of(idx)] |= mask_of(idx);
+			}
+
+			void remove(std::size_t idx)
+			{
+				if (word_of(idx) < the_set.size())
+					the_set[word_of(idx)] &= ~mask_of(idx);
+			}
+
+			friend std::ostream& operator<< (std::ostream& stream,
+			                                 const Packed_index_set& s)
+			{
+				bool first = true;
+				stream << "{";
+				for (std::size_t i = 0; i < s.the_set.size() * bits_per_word; i++)
+					if (s.contains(i)) {
+						if (!first)
+							stream << ", ";
+						first = false;
+						stream << i;
+					}
+				stream << "}";
+
+				return stream;
+			}
+
+			private:
+
+			Set_type the_set;
+
+			static std::size_t word_of(std::size_t idx)
+			{
+				return idx / bits_per_word;
+			}
+
+			static Word mask_of(std::size_t idx)
+			{
+				return Word(1) << (idx % bits_per_word);
+			}
+
+			// words beyond the end are implicitly zero
+			Word word(std::size_t i) const
+			{
+				return i < the_set.size() ? the_set[i] : 0;
+			}
+
+			// no accidental copies
+			Packed_index_set(const Packed_index_set& origin) = delete;
+		};
+
+		// The set type that the analysis engines use to track which jobs
+		// have been scheduled. The plain bit-vector variant is kept
+		// around for debugging and comparison purposes.
+#ifdef CONFIG_PACKED_INDEX_SET
+		typedef Packed_index_set Job_index_set;
+#else
+		typedef Index_set Job_index_set;
+#endif
 }
 
 #endif
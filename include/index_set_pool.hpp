@@ -0,0 +1,158 @@
+#ifndef INDEX_SET_POOL_HPP
+#define INDEX_SET_POOL_HPP
+
+#include <unordered_map>
+#include <deque>
+
+#include "config.h"
+
+#ifdef CONFIG_PARALLEL
+#include "tbb/concurrent_hash_map.h"
+#include "tbb/enumerable_thread_specific.h"
+#endif
+
+#include "jobs.hpp"
+#include "index_set.hpp"
+#include "arena.hpp"
+
+namespace NP {
+
+	// the (shared) empty set that initial states start from
+	template<class Set>
+	const Set& empty_index_set()
+	{
+		static const Set empty;
+		return empty;
+	}
+
+	// Hash-consed storage for index sets. Each distinct set is stored
+	// exactly once, so states that have scheduled the same jobs can share
+	// one copy, and two sets obtained from the same pool are equal if and
+	// only if they are the same object.
+	//
+	// The analysis engines keep one pool per exploration depth, so the
+	// whole pool can be discarded once all states of that depth are done.
+	template<class Set>
+	class Index_set_pool
+	{
+		public:
+
+		// If an arena is given, the sets (and the pool's own bookkeeping)
+		// are allocated from it, which must hence outlive the pool.
+		Index_set_pool(Arena* arena = nullptr)
+		: arena(arena)
+#ifdef CONFIG_PARALLEL
+		, storage([arena] () { return Sets(Sets_allocator(arena)); })
+		, sets_by_key(Sets_map_allocator(arena))
+#else
+		, storage(Sets_allocator(arena))
+		, sets_by_key(0, std::hash<hash_value_t>(),
+		              std::equal_to<hash_value_t>(),
+		              Sets_map_allocator(arena))
+#endif
+		, num_sets(0)
+		{
+		}
+
+		// Returns the unique instance of the set {from, idx}. The key must
+		// be a hash of the resulting set (e.g., a state's lookup key).
+		const Set& intern(const Set& from, std::size_t idx, hash_value_t key)
+		{
+#ifdef CONFIG_PARALLEL
+			Sets_map_accessor acc;
+			// find the existing list or create a new one
+			sets_by_key.insert(acc, key);
+			const Entry*& list = acc->second;
+#else
+			const Entry*& list = sets_by_key[key];
+#endif
+			for (const Entry* e = list; e; e = e->next)
+				if (e->set.equals_with(from, idx))
+					return e->set;
+
+			// not seen yet, so create it
+			Sets& storage = sets();
+			storage.emplace_back(from, idx, arena, list);
+			list = &storage.back();
+#ifdef CONFIG_PARALLEL
+			num_sets_local.local()++;
+#else
+			num_sets++;
+#endif
+			return list->set;
+		}
+
+		// number of distinct sets stored in this pool
+		std::size_t size() const
+		{
+#ifdef CONFIG_PARALLEL
+			std::size_t n = 0;
+			for (auto c : num_sets_local)
+				n += c;
+			return n;
+#else
+			return num_sets;
+#endif
+		}
+
+		private:
+
+		// a stored set, chained with the other sets that have the same key
+		struct Entry {
+			const Set set;
+			const Entry* const next;
+
+			Entry(const Set& from, std::size_t idx, Arena* arena,
+			      const Entry* next)
+			: set(from, idx, arena)
+			, next(next)
+			{
+			}
+		};
+
+		typedef Arena_allocator<Entry> Sets_allocator;
+		typedef std::deque<Entry, Sets_allocator> Sets;
+
+		typedef std::pair<const hash_value_t, const Entry*> Sets_map_value;
+		typedef Arena_allocator<Sets_map_value> Sets_map_allocator;
+
+		Arena* const arena;
+
+#ifdef CONFIG_PARALLEL
+		typedef tbb::concurrent_hash_map<hash_value_t, const Entry*,
+		                                 tbb::tbb_hash_compare<hash_value_t>,
+		                                 Sets_map_allocator> Sets_map;
+		typedef typename Sets_map::accessor Sets_map_accessor;
+
+		tbb::enumerable_thread_specific<Sets> storage;
+		tbb::enumerable_thread_specific<std::size_t> num_sets_local;
+
+		Sets& sets()
+		{
+			return storage.local();
+		}
+#else
+		typedef std::unordered_map<hash_value_t, const Entry*,
+		                           std::hash<hash_value_t>,
+		                           std::equal_to<hash_value_t>,
+		                           Sets_map_allocator> Sets_map;
+
+		Sets storage;
+
+		Sets& sets()
+		{
+			return storage;
+		}
+#endif
+
+		Sets_map sets_by_key;
+		std::size_t num_sets;
+
+		// no accidental copies
+		Index_set_pool(const Index_set_pool& origin) = delete;
+	};
+
+	typedef Index_set_pool<Job_index_set> Job_set_pool;
+}
+
+#endif
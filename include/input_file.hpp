@@ -0,0 +1,288 @@
+#ifndef INPUT_FILE_HPP
+#define INPUT_FILE_HPP
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <iostream>
+#include <iterator>
+#include <system_error>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#else
+#include <fstream>
+#endif
+
+#include "decompress.hpp"
+
+namespace NP {
+
+	// how long it took to read an input file
+	struct Input_statistics
+	{
+		// size of the compressed inputs (zero if none were compressed)
+		std::size_t compressed_bytes;
+		// size of the (decompressed) text of the inputs
+		std::size_t text_bytes;
+		// ... of which this much was compressed
+		std::size_t decompressed_bytes;
+		// seconds spent decompressing (in the decompressing thread)
+		double decompression_time;
+		// seconds spent parsing the text
+		double parse_time;
+
+		Input_statistics()
+		: compressed_bytes(0)
+		, text_bytes(0)
+		, decompressed_bytes(0)
+		, decompression_time(0)
+		, parse_time(0)
+		{
+		}
+
+		Input_statistics& operator+=(const Input_statistics& other)
+		{
+			compressed_bytes += other.compressed_bytes;
+			text_bytes += other.text_bytes;
+			decompressed_bytes += other.decompressed_bytes;
+			decompression_time += other.decompression_time;
+			parse_time += other.parse_time;
+			return *this;
+		}
+
+		// in MiB of decompressed text per second (zero if none)
+		double decompression_speed() const
+		{
+			return speed(decompressed_bytes, decompression_time);
+		}
+
+		// in MiB of text per second
+		double parse_speed() const
+		{
+			return speed(text_bytes, parse_time);
+		}
+
+		private:
+
+		static double speed(std::size_t bytes, double seconds)
+		{
+			return seconds > 0 ? bytes / (1024.0 * 1024.0) / seconds : 0;
+		}
+	};
+
+	// The read-only contents of an input file. Regular files are mapped
+	// into memory, so that the parsers can work on the page cache
+	// directly; other inputs (pipes, std::cin, streams given by the
+	// caller) are read into a buffer. The default-constructed input is
+	// empty.
+	//
+	// Inputs compressed with gzip or zstd (recognized by their magic
+	// numbers) are decompressed on the fly when their text is read with
+	// for_each_block().
+	class Input_file
+	{
+		public:
+
+		Input_file()
+		: map(nullptr)
+		, map_size(0)
+		, compression(Compression::none)
+		{
+		}
+
+		// "-" stands for std::cin
+		explicit Input_file(const std::string& path)
+		: Input_file()
+		{
+			file_name = path;
+			if (path == "-")
+				read_all(std::cin);
+			else
+				open(path);
+			compression = compression_of(begin(), size());
+		}
+
+		explicit Input_file(std::istream& in, const std::string& name = "")
+		: Input_file()
+		{
+			file_name = name;
+			read_all(in);
+			compression = compression_of(begin(), size());
+		}
+
+		Input_file(const Input_file&) = delete;
+		Input_file& operator=(const Input_file&) = delete;
+
+		Input_file(Input_file&& other)
+		: Input_file()
+		{
+			swap(other);
+		}
+
+		Input_file& operator=(Input_file&& other)
+		{
+			swap(other);
+			return *this;
+		}
+
+		~Input_file()
+		{
+#ifndef _WIN32
+			if (map)
+				munmap(map, map_size);
+#endif
+		}
+
+		// the contents as stored (i.e., still compressed, if so)
+		const char* begin() const
+		{
+			return map ? static_cast<const char*>(map) : buffer.data();
+		}
+
+		const char* end() const
+		{
+			return begin() + size();
+		}
+
+		std::size_t size() const
+		{
+			return map ? map_size : buffer.size();
+		}
+
+		const std::string& name() const
+		{
+			return file_name;
+		}
+
+		bool is_compressed() const
+		{
+			return compression != Compression::none;
+		}
+
+		// Calls f(begin, end) for each block of the text, in order. The
+		// text of an uncompressed input is a single block; compressed
+		// inputs are decompressed in a separate thread and handed out in
+		// blocks that end at line breaks while the rest is decompressed.
+		template<typename F>
+		void for_each_block(F f) const
+		{
+			typedef std::chrono::steady_clock Clock;
+
+			auto parse = [&] (const char* from, const char* to) {
+				auto start = Clock::now();
+				f(from, to);
+				std::chrono::duration<double> took = Clock::now() - start;
+				stats.parse_time += took.count();
+				stats.text_bytes += to - from;
+			};
+
+			if (!is_compressed()) {
+				parse(begin(), end());
+				return;
+			}
+
+			Decompressing_stream text(compression, begin(), size());
+			std::string block;
+			while (text.next(block)) {
+				parse(block.data(), block.data() + block.size());
+				stats.decompressed_bytes += block.size();
+			}
+			stats.compressed_bytes += size();
+			stats.decompression_time += text.decompression_time();
+		}
+
+		// the first (up to) n bytes of the text
+		std::string prefix(std::size_t n) const
+		{
+			if (!is_compressed())
+				return std::string(begin(), std::min(n, size()));
+			else
+				return Decompressing_stream::prefix(compression, begin(),
+				                                    size(), n);
+		}
+
+		// how long for_each_block() took so far
+		const Input_statistics& statistics() const
+		{
+			return stats;
+		}
+
+		private:
+
+		std::string file_name;
+		std::string buffer;
+		void* map;
+		std::size_t map_size;
+		Compression compression;
+		mutable Input_statistics stats;
+
+		void swap(Input_file& other)
+		{
+			std::swap(file_name, other.file_name);
+			std::swap(buffer, other.buffer);
+			std::swap(map, other.map);
+			std::swap(map_size, other.map_size);
+			std::swap(compression, other.compression);
+			std::swap(stats, other.stats);
+		}
+
+		void read_all(std::istream& in)
+		{
+			buffer.assign(std::istreambuf_iterator<char>(in),
+			              std::istreambuf_iterator<char>());
+		}
+
+#ifndef _WIN32
+		void open(const std::string& path)
+		{
+			int fd = ::open(path.c_str(), O_RDONLY);
+			if (fd < 0)
+				throw std::system_error(errno, std::generic_category(), path);
+
+			struct stat st;
+			if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+				void* m = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE,
+				               fd, 0);
+				if (m != MAP_FAILED) {
+					// the parsers read the file front to back
+					madvise(m, st.st_size, MADV_SEQUENTIAL);
+					map = m;
+					map_size = st.st_size;
+				}
+			}
+
+			if (!map) {
+				// empty, not a regular file, or cannot be mapped
+				char chunk[1 << 16];
+				ssize_t n;
+				while ((n = ::read(fd, chunk, sizeof(chunk))) > 0)
+					buffer.append(chunk, n);
+				if (n < 0) {
+					int err = errno;
+					::close(fd);
+					throw std::system_error(err, std::generic_category(), path);
+				}
+			}
+			::close(fd);
+		}
+#else
+		void open(const std::string& path)
+		{
+			std::ifstream in(path, std::ios::in | std::ios::binary);
+			if (!in)
+				throw std::system_error(ENOENT, std::generic_category(), path);
+			read_all(in);
+		}
+#endif
+	};
+
+}
+
+#endif
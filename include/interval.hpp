@@ -2,6 +2,7 @@
 #define INTERVAL_HPP
 
 #include <cassert>
+#include <algorithm>
 #include <ostream>
 #include <memory>
 #include <vector>
@@ -157,6 +158,28 @@ template<class T> std::ostream& operator<< (std::ostream& stream, const Interval
 
 
 
+struct Lookup_table_occupancy {
+	// number of buckets
+	std::size_t buckets;
+	// number of entries in all buckets (an item is entered into
+	// every bucket that its interval overlaps with)
+	std::size_t entries;
+	// number of entries in the largest bucket
+	std::size_t largest;
+	// average size of the bucket in which an item's interval starts
+	double typical;
+
+	Lookup_table_occupancy()
+	: buckets(0), entries(0), largest(0), typical(0)
+	{
+	}
+
+	double mean() const
+	{
+		return buckets ? (double) entries / buckets : 0;
+	}
+};
+
 template<class T, class X, Interval<T> (*map)(const X&)> class Interval_lookup_table {
 	typedef std::vector<std::reference_wrapper<const X>> Bucket;
 
@@ -165,14 +188,22 @@ template<class T, class X, Interval<T> (*map)(const X&)> class Interval_lookup_t
 	std::unique_ptr<Bucket[]> buckets;
 	const Interval<T> range;
 	const T width;
+	// where each bucket starts if the buckets are not uniform (the
+	// first bucket also covers everything before), empty otherwise
+	std::vector<T> starts;
 	const unsigned int num_buckets;
+	// how many intervals start in each bucket
+	std::vector<std::size_t> first_of;
 
 
 	public:
 
 	std::size_t bucket_of(const T& point) const
 	{
-		if (range.contains(point)) {
+		if (!starts.empty()) {
+			auto it = std::upper_bound(starts.begin() + 1, starts.end(), point);
+			return static_cast<std::size_t>(it - starts.begin()) - 1;
+		} else if (range.contains(point)) {
 			return static_cast<std::size_t>((point - range.from()) / width);
 		} else if (point < range.from()) {
 			return 0;
@@ -180,16 +211,53 @@ template<class T, class X, Interval<T> (*map)(const X&)> class Interval_lookup_t
 			return num_buckets - 1;
 	}
 
+	// uniform buckets of the given width
 	Interval_lookup_table(const Interval<T>& range, T bucket_width)
 	: range(range)
 	, width(std::max(bucket_width, static_cast<T>(1)))
 	, num_buckets(1 + std::max(
 	                  static_cast<std::size_t>(range.length() / this->width),
 	                  static_cast<std::size_t>(1)))
+	, first_of(num_buckets, 0)
 	{
 		buckets = std::make_unique<Bucket[]>(num_buckets);
 	}
 
+	// buckets that start at the given, increasing points in time
+	Interval_lookup_table(const Interval<T>& range, std::vector<T> bucket_starts)
+	: range(range)
+	, width(0)
+	, starts(std::move(bucket_starts))
+	, num_buckets(starts.size())
+	, first_of(num_buckets, 0)
+	{
+		assert(!starts.empty());
+		assert(std::is_sorted(starts.begin(), starts.end()));
+		buckets = std::make_unique<Bucket[]>(num_buckets);
+	}
+
+	// Bucket starts for (at most) the given number of buckets such that
+	// about equally many intervals start in each bucket, i.e., buckets
+	// are narrow where many intervals begin and wide where few do.
+	template<class Collection>
+	static std::vector<T> balanced_bucket_starts(
+		const Interval<T>& range, const Collection& xs, std::size_t n)
+	{
+		std::vector<T> from;
+		from.reserve(xs.size());
+		for (const X& x : xs)
+			from.push_back(map(x).from());
+		std::sort(from.begin(), from.end());
+
+		std::vector<T> starts{range.from()};
+		for (std::size_t k = 1; k < n && !from.empty(); k++) {
+			T s = from[k * from.size() / n];
+			if (s > starts.back())
+				starts.push_back(s);
+		}
+		return starts;
+	}
+
 	void insert(const X& x)
 	{
 		Interval<T> w = map(x);
@@ -198,6 +266,7 @@ template<class T, class X, Interval<T> (*map)(const X&)> class Interval_lookup_t
 		assert(b < num_buckets);
 		for (auto i = a; i <= b; i++)
 			buckets[i].push_back(x);
+		first_of[a]++;
 	}
 
 	const Bucket& lookup(T point) const
@@ -210,6 +279,62 @@ template<class T, class X, Interval<T> (*map)(const X&)> class Interval_lookup_t
 		return buckets[i];
 	}
 
+	std::size_t size() const
+	{
+		return num_buckets;
+	}
+
+	Lookup_table_occupancy occupancy() const
+	{
+		std::vector<std::size_t> sizes(num_buckets);
+		for (std::size_t i = 0; i < num_buckets; i++)
+			sizes[i] = buckets[i].size();
+		return occupancy(sizes, first_of);
+	}
+
+	// the occupancy that inserting all of xs would result in (without
+	// actually inserting anything)
+	template<class Collection>
+	Lookup_table_occupancy occupancy_with(const Collection& xs) const
+	{
+		std::vector<std::size_t> first(num_buckets, 0);
+		std::vector<std::size_t> begin(num_buckets, 0), end(num_buckets, 0);
+		for (const X& x : xs) {
+			Interval<T> w = map(x);
+			auto a = bucket_of(w.from()), b = bucket_of(w.until());
+			first[a]++;
+			begin[a]++;
+			end[b]++;
+		}
+		std::vector<std::size_t> sizes(num_buckets);
+		std::size_t open = 0;
+		for (std::size_t i = 0; i < num_buckets; i++) {
+			open += begin[i];
+			sizes[i] = open;
+			open -= end[i];
+		}
+		return occupancy(sizes, first);
+	}
+
+	private:
+
+	static Lookup_table_occupancy occupancy(
+		const std::vector<std::size_t>& sizes,
+		const std::vector<std::size_t>& first)
+	{
+		Lookup_table_occupancy o;
+		std::size_t weighted = 0, items = 0;
+		o.buckets = sizes.size();
+		for (std::size_t i = 0; i < sizes.size(); i++) {
+			o.entries += sizes[i];
+			o.largest = std::max(o.largest, sizes[i]);
+			weighted += sizes[i] * first[i];
+			items += first[i];
+		}
+		o.typical = items ? (double) weighted / items : 0;
+		return o;
+	}
+
 };
 
 #endif
@@ -1,199 +1,317 @@
 #ifndef IO_HPP
 #define IO_HPP
 
+#include <algorithm>
+#include <cstring>
 #include <iostream>
+#include <memory>
+#include <string>
 #include <utility>
+#include <vector>
+
+#ifdef CONFIG_PARALLEL
+#include "tbb/parallel_for.h"
+#endif
 
 #include "interval.hpp"
 #include "time.hpp"
 #include "jobs.hpp"
 #include "precedence.hpp"
 #include "aborts.hpp"
+#include "csv.hpp"
+#include "input_file.hpp"
+#include "binary_io.hpp"
 
 namespace NP {
 
-	inline void skip_over(std::istream& in, char c)
+	inline JobID parse_job_id(Csv_reader& in)
 	{
-		while (in.good() && in.get() != (int) c)
-			/* skip */;
+		auto tid = in.number<unsigned long>();
+		in.next_field();
+		auto jid = in.number<unsigned long>();
+		return JobID(jid, tid);
 	}
 
-	inline bool skip_one(std::istream& in, char c)
+	inline Precedence_constraint parse_precedence_constraint(Csv_reader& in)
 	{
-		if (in.good() && in.peek() == (int) c) {
-			in.get(); /* skip */
-			return true;
-		} else
-			return false;
-	}
+		// first two columns
+		auto from = parse_job_id(in);
 
-	inline void skip_all(std::istream& in, char c)
-	{
-		while (skip_one(in, c))
-			/* skip */;
+		in.next_field();
+
+		// last two columns
+		auto to = parse_job_id(in);
+
+		return Precedence_constraint(from, to);
 	}
 
-	inline bool more_data(std::istream& in)
+	template<class Time> Job<Time> parse_job(Csv_reader& in)
 	{
-		in.peek();
-		return !in.eof();
+		auto tid = in.number<unsigned long>();
+		in.next_field();
+		auto jid = in.number<unsigned long>();
+		in.next_field();
+		auto arr_min = in.number<Time>();
+		in.next_field();
+		auto arr_max = in.number<Time>();
+		in.next_field();
+		auto cost_min = in.number<Time>();
+		in.next_field();
+		auto cost_max = in.number<Time>();
+		in.next_field();
+		auto dl = in.number<Time>();
+		in.next_field();
+		auto prio = in.number<Time>();
+
+		return Job<Time>{jid, Interval<Time>{arr_min, arr_max},
+						 Interval<Time>{cost_min, cost_max}, dl, prio, tid};
 	}
 
-	inline void next_field(std::istream& in)
+	template<class Time>
+	Abort_action<Time> parse_abort_action(Csv_reader& in)
 	{
-		// eat up any trailing spaces
-		skip_all(in, ' ');
-		// eat up field separator
-		skip_one(in, ',');
+		auto tid = in.number<unsigned long>();
+		in.next_field();
+		auto jid = in.number<unsigned long>();
+		in.next_field();
+		auto trig_min = in.number<Time>();
+		in.next_field();
+		auto trig_max = in.number<Time>();
+		in.next_field();
+		auto cleanup_min = in.number<Time>();
+		in.next_field();
+		auto cleanup_max = in.number<Time>();
+
+		return Abort_action<Time>{JobID{jid, tid},
+		                          Interval<Time>{trig_min, trig_max},
+		                          Interval<Time>{cleanup_min, cleanup_max}};
 	}
 
-	inline void next_line(std::istream& in)
+	// parse the rows of the chunk until its end
+	template<class Row, typename Parse_row>
+	void parse_rows(Csv_reader& in, Parse_row parse_row,
+	                std::vector<Row>& rows)
 	{
-		skip_over(in, '\n');
+		while (in.more_rows()) {
+			rows.push_back(parse_row(in));
+			// munge any trailing whitespace or extra columns
+			in.next_line();
+		}
 	}
 
-	inline JobID parse_job_id(std::istream& in)
+	// Parses the rows in [begin, end), the first of which is on line
+	// first_line, and appends them to rows. In parallel runs, large
+	// blocks are split at line breaks into chunks of about chunk_size
+	// bytes, which are parsed concurrently. Throws Parse_error for the
+	// first bad row.
+	template<class Row, typename Parse_row>
+	void parse_block(const char* begin, const char* end,
+	                 const std::string& file, std::size_t first_line,
+	                 Parse_row parse_row, std::vector<Row>& rows,
+	                 std::size_t chunk_size = 1 << 20)
 	{
-		unsigned long jid, tid;
+#ifdef CONFIG_PARALLEL
+		if ((std::size_t) (end - begin) > 2 * chunk_size) {
+			std::vector<const char*> cuts{begin};
+			while ((std::size_t) (end - cuts.back()) > chunk_size) {
+				auto from = cuts.back() + chunk_size;
+				auto nl = static_cast<const char*>(
+					std::memchr(from, '\n', end - from));
+				if (!nl)
+					break;
+				cuts.push_back(nl + 1);
+			}
+			cuts.push_back(end);
+
+			auto num_chunks = cuts.size() - 1;
+			std::vector<std::vector<Row>> parts(num_chunks);
+			std::vector<std::unique_ptr<Parse_error>> errors(num_chunks);
+			tbb::parallel_for(std::size_t(0), num_chunks, [&] (std::size_t k) {
+				// line numbers are relative to the chunk for now
+				Csv_reader chunk(cuts[k], cuts[k + 1], file);
+				try {
+					parse_rows(chunk, parse_row, parts[k]);
+				} catch (Parse_error& e) {
+					errors[k].reset(new Parse_error(e));
+				}
+			});
+
+			for (std::size_t k = 0; k < num_chunks; k++)
+				if (errors[k]) {
+					auto line = first_line + errors[k]->line - 1
+					            + std::count(begin, cuts[k], '\n');
+					throw Parse_error(file, line, errors[k]->column,
+					                  errors[k]->problem);
+				}
+
+			std::size_t n = rows.size();
+			for (const auto& p : parts)
+				n += p.size();
+			rows.reserve(n);
+			for (auto& p : parts)
+				rows.insert(rows.end(), std::make_move_iterator(p.begin()),
+				            std::make_move_iterator(p.end()));
+			return;
+		}
+#else
+		(void) chunk_size;
+#endif
 
-		in >> tid;
-		next_field(in);
-		in >> jid;
-		return JobID(jid, tid);
+		Csv_reader in(begin, end, file, first_line);
+		parse_rows(in, parse_row, rows);
 	}
 
-	inline Precedence_constraint parse_precedence_constraint(std::istream &in)
+	// Parses all rows of a file held in [begin, end) (the first row
+	// contains the column headers and is skipped).
+	template<class Row, typename Parse_row>
+	std::vector<Row> parse_rows(const char* begin, const char* end,
+	                            const std::string& file,
+	                            Parse_row parse_row,
+	                            std::size_t chunk_size = 1 << 20)
 	{
-		std::ios_base::iostate state_before = in.exceptions();
-		in.exceptions(std::istream::failbit | std::istream::badbit);
+		Csv_reader header(begin, end, file);
+		header.next_line();
 
-		// first two columns
-		auto from = parse_job_id(in);
-
-		next_field(in);
-
-		// last two columns
-		auto to = parse_job_id(in);
-
-		in.exceptions(state_before);
-
-		return Precedence_constraint(from, to);
+		std::vector<Row> rows;
+		parse_block(header.position(), end, file, header.line(),
+		            parse_row, rows, chunk_size);
+		return rows;
 	}
 
-	inline Precedence_constraints parse_dag_file(std::istream& in)
+	// ... of an input file, block by block as its text becomes available
+	// (see Input_file::for_each_block())
+	template<class Row, typename Parse_row>
+	std::vector<Row> parse_rows(const Input_file& in, Parse_row parse_row)
 	{
-		Precedence_constraints edges;
+		std::vector<Row> rows;
+		bool at_header = true;
+		std::size_t line = 1;
+
+		in.for_each_block([&] (const char* begin, const char* end) {
+			Csv_reader block(begin, end, in.name(), line);
+			if (at_header) {
+				block.next_line();
+				at_header = false;
+			}
+			parse_block(block.position(), end, in.name(), block.line(),
+			            parse_row, rows);
+			// more blocks follow only if the input is compressed
+			if (in.is_compressed())
+				line = block.line() + std::count(block.position(), end, '\n');
+		});
+
+		return rows;
+	}
 
-		// skip column headers
-		next_line(in);
+	inline Precedence_constraints parse_dag_file(const Input_file& in)
+	{
+		// each row contains one precedence constraint
+		return parse_rows<Precedence_constraint>(in, [] (Csv_reader& row) {
+			return parse_precedence_constraint(row);
+		});
+	}
 
-		// parse all rows
-		while (more_data(in)) {
-			// each row contains one precedence constraint
-			edges.push_back(parse_precedence_constraint(in));
-			next_line(in);
-		}
+	template<class Time>
+	typename Job<Time>::Job_set parse_file(const Input_file& in)
+	{
+		return parse_rows<Job<Time>>(in, [] (Csv_reader& row) {
+			return parse_job<Time>(row);
+		});
+	}
 
-		return edges;
+	template<class Time>
+	std::vector<Abort_action<Time>> parse_abort_file(const Input_file& in)
+	{
+		return parse_rows<Abort_action<Time>>(in, [] (Csv_reader& row) {
+			return parse_abort_action<Time>(row);
+		});
 	}
 
-	template<class Time> Job<Time> parse_job(std::istream& in)
+	// Loads a workload from a job set file, which can be a CSV file or a
+	// binary job set file (detected by its header), and the CSV files of
+	// precedence constraints and abort actions (both may be empty). The
+	// constraints and abort actions of a binary job set file are kept,
+	// and the ones from the CSV files are added.
+	template<class Time>
+	Workload_data<Time> load_workload(const Input_file& jobs_in,
+	                                  const Input_file& dag_in,
+	                                  const Input_file& aborts_in)
 	{
-		unsigned long tid, jid;
+		Workload_data<Time> w;
 
-		std::ios_base::iostate state_before = in.exceptions();
+		if (is_binary_job_set(jobs_in))
+			w = load_binary_job_set<Time>(jobs_in);
+		else
+			w.jobs = parse_file<Time>(jobs_in);
 
-		Time arr_min, arr_max, cost_min, cost_max, dl, prio;
+		auto dag = parse_dag_file(dag_in);
+		w.dag.insert(w.dag.end(), dag.begin(), dag.end());
 
-		in.exceptions(std::istream::failbit | std::istream::badbit);
+		auto aborts = parse_abort_file<Time>(aborts_in);
+		w.aborts.insert(w.aborts.end(), aborts.begin(), aborts.end());
 
-		in >> tid;
-		next_field(in);
-		in >> jid;
-		next_field(in);
-		in >> arr_min;
-		next_field(in);
-		in >> arr_max;
-		next_field(in);
-		in >> cost_min;
-		next_field(in);
-		in >> cost_max;
-		next_field(in);
-		in >> dl;
-		next_field(in);
-		in >> prio;
+		return w;
+	}
 
-		in.exceptions(state_before);
+	// The stream versions read the whole stream (for the file parsers)
+	// or its next line (for the row parsers) into memory first.
 
-		return Job<Time>{jid, Interval<Time>{arr_min, arr_max},
-						 Interval<Time>{cost_min, cost_max}, dl, prio, tid};
+	template<typename Parse_row>
+	auto parse_line(std::istream& in, Parse_row parse_row)
+		-> decltype(parse_row(std::declval<Csv_reader&>()))
+	{
+		std::string line;
+		std::getline(in, line);
+		Csv_reader row(line.data(), line.data() + line.size());
+		return parse_row(row);
 	}
 
-	template<class Time>
-	typename Job<Time>::Job_set parse_file(std::istream& in)
+	inline JobID parse_job_id(std::istream& in)
 	{
-		// first row contains a comment, just skip it
-		next_line(in);
-
-		typename Job<Time>::Job_set jobs;
+		return parse_line(in, [] (Csv_reader& row) {
+			return parse_job_id(row);
+		});
+	}
 
-		while (more_data(in)) {
-			jobs.push_back(parse_job<Time>(in));
-			// munge any trailing whitespace or extra columns
-			next_line(in);
-		}
+	inline Precedence_constraint parse_precedence_constraint(std::istream &in)
+	{
+		return parse_line(in, [] (Csv_reader& row) {
+			return parse_precedence_constraint(row);
+		});
+	}
 
-		return jobs;
+	template<class Time> Job<Time> parse_job(std::istream& in)
+	{
+		return parse_line(in, [] (Csv_reader& row) {
+			return parse_job<Time>(row);
+		});
 	}
 
 	template<class Time>
 	Abort_action<Time> parse_abort_action(std::istream& in)
 	{
-		unsigned long tid, jid;
-		Time trig_min, trig_max, cleanup_min, cleanup_max;
-
-		std::ios_base::iostate state_before = in.exceptions();
-
-		in.exceptions(std::istream::failbit | std::istream::badbit);
-
-		in >> tid;
-		next_field(in);
-		in >> jid;
-		next_field(in);
-		in >> trig_min;
-		next_field(in);
-		in >> trig_max;
-		next_field(in);
-		in >> cleanup_min;
-		next_field(in);
-		in >> cleanup_max;
-
-		in.exceptions(state_before);
+		return parse_line(in, [] (Csv_reader& row) {
+			return parse_abort_action<Time>(row);
+		});
+	}
 
-		return Abort_action<Time>{JobID{jid, tid},
-		                          Interval<Time>{trig_min, trig_max},
-		                          Interval<Time>{cleanup_min, cleanup_max}};
+	inline Precedence_constraints parse_dag_file(std::istream& in)
+	{
+		return parse_dag_file(Input_file(in));
 	}
 
+	template<class Time>
+	typename Job<Time>::Job_set parse_file(std::istream& in)
+	{
+		return parse_file<Time>(Input_file(in));
+	}
 
 	template<class Time>
 	std::vector<Abort_action<Time>> parse_abort_file(std::istream& in)
 	{
-		// first row contains a comment, just skip it
-		next_line(in);
-
-		std::vector<Abort_action<Time>> abort_actions;
-
-		while (more_data(in)) {
-			abort_actions.push_back(parse_abort_action<Time>(in));
-			// munge any trailing whitespace or extra columns
-			next_line(in);
-		}
-
-		return abort_actions;
+		return parse_abort_file<Time>(Input_file(in));
 	}
 
-
 }
 
 #endif
@@ -0,0 +1,277 @@
+#ifndef JOB_TABLE_HPP
+#define JOB_TABLE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cassert>
+#include <algorithm>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include "config.h"
+#include "jobs.hpp"
+#include "index_set.hpp"
+
+#if defined(CONFIG_SIMD_SCANS) && defined(CONFIG_PACKED_INDEX_SET) \
+    && (defined(__GNUC__) || defined(__clang__)) \
+    && (defined(__x86_64__) || defined(__i386__))
+#define NP_AVX2_SCANS
+#include <immintrin.h>
+#endif
+
+namespace NP {
+
+	// A fixed-size array of plain values aligned to a cache line.
+	template<typename T>
+	class Aligned_array
+	{
+		static_assert(std::is_trivial<T>::value,
+		              "only for plain values");
+
+		public:
+
+		static const std::size_t alignment = 64;
+
+		Aligned_array(std::size_t n = 0)
+		: memory(new char[n * sizeof(T) + alignment])
+		, n(n)
+		{
+			void* p = memory.get();
+			std::size_t space = n * sizeof(T) + alignment;
+			values = static_cast<T*>(std::align(alignment, n * sizeof(T), p, space));
+		}
+
+		T& operator[](std::size_t i)
+		{
+			assert(i < n);
+			return values[i];
+		}
+
+		const T& operator[](std::size_t i) const
+		{
+			assert(i < n);
+			return values[i];
+		}
+
+		const T* data() const
+		{
+			return values;
+		}
+
+		std::size_t size() const
+		{
+			return n;
+		}
+
+		private:
+
+		std::unique_ptr<char[]> memory;
+		T* values;
+		std::size_t n;
+	};
+
+	// The attributes of all jobs of a workload that the scans for ready
+	// jobs look at, as a structure of arrays indexed by the jobs'
+	// positions in the workload.
+	//
+	// Besides the latest arrival times, the table holds each job's rank
+	// in the priority order of Job::higher_priority_than() (including its
+	// tie-breaks), so that a priority comparison is a single integer
+	// comparison: j has a higher priority than k iff rank(j) < rank(k).
+	template<class Time>
+	class Job_table
+	{
+		public:
+
+		typedef std::int64_t Rank;
+		typedef std::uint32_t Index;
+		typedef typename Job<Time>::Job_set Workload;
+
+		// ranks below this cover all jobs
+		static const Rank no_rank = INT64_MAX;
+
+		Job_table(const Workload& jobs)
+		: latest_arrivals(jobs.size())
+		, ranks(jobs.size())
+		{
+			assert(jobs.size() <= UINT32_MAX);
+
+			for (std::size_t i = 0; i < jobs.size(); i++)
+				latest_arrivals[i] = jobs[i].latest_arrival();
+
+			std::vector<std::size_t> by_prio(jobs.size());
+			for (std::size_t i = 0; i < jobs.size(); i++)
+				by_prio[i] = i;
+			auto higher = [&] (std::size_t a, std::size_t b) {
+				return jobs[a].higher_priority_than(jobs[b]);
+			};
+			std::sort(by_prio.begin(), by_prio.end(), higher);
+			// jobs that are not ordered either way share a rank
+			Rank r = 0;
+			for (std::size_t i = 0; i < by_prio.size(); i++) {
+				if (i && higher(by_prio[i - 1], by_prio[i]))
+					r++;
+				ranks[by_prio[i]] = r;
+			}
+		}
+
+		std::size_t size() const
+		{
+			return ranks.size();
+		}
+
+		Time latest_arrival(std::size_t j) const
+		{
+			return latest_arrivals[j];
+		}
+
+		Rank rank(std::size_t j) const
+		{
+			return ranks[j];
+		}
+
+		private:
+
+		Aligned_array<Time> latest_arrivals;
+		Aligned_array<Rank> ranks;
+	};
+
+	// A list of jobs, together with copies of their latest arrival times
+	// and priority ranks (see Job_table) in separate contiguous arrays,
+	// so that the list can be scanned without touching the jobs.
+	template<class Time>
+	class Job_scan_list
+	{
+		public:
+
+		typedef typename Job_table<Time>::Rank Rank;
+		typedef typename Job_table<Time>::Index Index;
+
+		void push_back(const Job_table<Time>& table, Index j)
+		{
+			indices.push_back(j);
+			latest_arrivals.push_back(table.latest_arrival(j));
+			ranks.push_back(table.rank(j));
+		}
+
+		std::size_t size() const
+		{
+			return indices.size();
+		}
+
+		// Returns the minimum latest arrival time of the listed jobs that
+		// are not in the set of scheduled jobs and that rank before
+		// below_rank (i.e., have a higher priority than a job of that
+		// rank), or infinity if there are no such jobs.
+		template<class Set>
+		Time min_latest_arrival(const Set& scheduled,
+		                        Rank below_rank = Job_table<Time>::no_rank) const
+		{
+			return scalar_min_latest_arrival(scheduled, below_rank);
+		}
+
+#ifdef NP_AVX2_SCANS
+		Time min_latest_arrival(const Packed_index_set& scheduled,
+		                        Rank below_rank = Job_table<Time>::no_rank) const
+		{
+			if (use_avx2())
+				return avx2_min_latest_arrival(scheduled, below_rank);
+			else
+				return scalar_min_latest_arrival(scheduled, below_rank);
+		}
+#endif
+
+		template<class Set>
+		Time scalar_min_latest_arrival(const Set& scheduled, Rank below_rank,
+		                               std::size_t from = 0) const
+		{
+			Time when = Time_model::constants<Time>::infinity();
+			for (std::size_t k = from; k < indices.size(); k++)
+				if (ranks[k] < below_rank && !scheduled.contains(indices[k]))
+					when = std::min(when, latest_arrivals[k]);
+			return when;
+		}
+
+		private:
+
+		std::vector<Index> indices;
+		std::vector<Time> latest_arrivals;
+		std::vector<Rank> ranks;
+
+#ifdef NP_AVX2_SCANS
+		public:
+
+		static bool use_avx2()
+		{
+			static const bool supported = __builtin_cpu_supports("avx2");
+			return supported;
+		}
+
+		// four jobs at a time; only for 64-bit integer times
+		template<typename T = Time,
+		         typename std::enable_if<std::is_same<T, long long>::value, int>::type = 0>
+		__attribute__((target("avx2")))
+		Time avx2_min_latest_arrival(const Packed_index_set& scheduled,
+		                             Rank below_rank) const
+		{
+			const std::size_t n = indices.size();
+			const long long* words =
+				reinterpret_cast<const long long*>(scheduled.words());
+
+			const __m256i zero = _mm256_setzero_si256();
+			const __m256i one = _mm256_set1_epi64x(1);
+			const __m256i bit_mask = _mm256_set1_epi64x(63);
+			const __m256i below = _mm256_set1_epi64x(below_rank);
+			const __m256i num_words = _mm256_set1_epi64x(scheduled.num_words());
+			const __m256i inf = _mm256_set1_epi64x(
+				Time_model::constants<Time>::infinity());
+			__m256i when = inf;
+
+			std::size_t k = 0;
+			for (; k + 4 <= n; k += 4) {
+				// higher priority?
+				__m256i rank = _mm256_loadu_si256(
+					reinterpret_cast<const __m256i*>(ranks.data() + k));
+				__m256i take = _mm256_cmpgt_epi64(below, rank);
+
+				// not yet scheduled? (words beyond the end are zero)
+				__m256i idx = _mm256_cvtepu32_epi64(_mm_loadu_si128(
+					reinterpret_cast<const __m128i*>(indices.data() + k)));
+				__m256i wi = _mm256_srli_epi64(idx, 6);
+				__m256i in_set = _mm256_cmpgt_epi64(num_words, wi);
+				__m256i w = _mm256_mask_i64gather_epi64(zero, words, wi, in_set, 8);
+				__m256i bit = _mm256_and_si256(
+					_mm256_srlv_epi64(w, _mm256_and_si256(idx, bit_mask)), one);
+				take = _mm256_and_si256(take, _mm256_cmpeq_epi64(bit, zero));
+
+				__m256i arrival = _mm256_blendv_epi8(inf,
+					_mm256_loadu_si256(reinterpret_cast<const __m256i*>(
+						latest_arrivals.data() + k)),
+					take);
+				when = _mm256_blendv_epi8(when, arrival,
+				                          _mm256_cmpgt_epi64(when, arrival));
+			}
+
+			alignas(32) long long lanes[4];
+			_mm256_store_si256(reinterpret_cast<__m256i*>(lanes), when);
+			Time result = std::min(std::min(lanes[0], lanes[1]),
+			                       std::min(lanes[2], lanes[3]));
+
+			return std::min(result,
+			                scalar_min_latest_arrival(scheduled, below_rank, k));
+		}
+
+		template<typename T = Time,
+		         typename std::enable_if<!std::is_same<T, long long>::value, int>::type = 0>
+		Time avx2_min_latest_arrival(const Packed_index_set& scheduled,
+		                             Rank below_rank) const
+		{
+			return scalar_min_latest_arrival(scheduled, below_rank);
+		}
+#endif
+	};
+
+}
+
+#endif
@@ -6,6 +6,8 @@
 #include <algorithm> // for find
 #include <functional> // for hash
 #include <exception>
+#include <memory>
+#include <unordered_map>
 
 #include "time.hpp"
 #include "interval.hpp"
@@ -254,4 +256,75 @@ namespace std {
 	};
 }
 
+namespace NP {
+
+	// Maps job IDs to the positions of the jobs in a job set, so that
+	// references to jobs by ID (in precedence constraints, abort
+	// actions, ...) can be resolved in constant time. The map does not
+	// change after construction, so copies simply share it.
+	class Job_id_map
+	{
+		public:
+
+		static const std::size_t npos = static_cast<std::size_t>(-1);
+
+		Job_id_map()
+		: positions(std::make_shared<Positions>())
+		{
+		}
+
+		template<class Time>
+		explicit Job_id_map(const std::vector<Job<Time>>& jobs)
+		{
+			auto p = std::make_shared<Positions>();
+			p->reserve(jobs.size());
+			for (std::size_t i = 0; i < jobs.size(); i++)
+				p->emplace(jobs[i].get_id(), i);
+			positions = p;
+		}
+
+		// position of the job with the given ID, or npos if there is none
+		std::size_t find(const JobID& id) const
+		{
+			auto pos = positions->find(id);
+			return pos == positions->end() ? npos : pos->second;
+		}
+
+		// position of the job with the given ID; throws
+		// InvalidJobReference if there is none
+		std::size_t index_of(const JobID& id) const
+		{
+			auto i = find(id);
+			if (i == npos)
+				throw InvalidJobReference(id);
+			return i;
+		}
+
+		bool contains(const JobID& id) const
+		{
+			return find(id) != npos;
+		}
+
+		std::size_t size() const
+		{
+			return positions->size();
+		}
+
+		private:
+
+		typedef std::unordered_map<JobID, std::size_t> Positions;
+
+		std::shared_ptr<const Positions> positions;
+	};
+
+	template<class Time>
+	const Job<Time>& lookup(const typename Job<Time>::Job_set& jobs,
+	                        const Job_id_map& index,
+	                        const JobID& id)
+	{
+		return jobs[index.index_of(id)];
+	}
+
+}
+
 #endif
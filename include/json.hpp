@@ -0,0 +1,443 @@
+#ifndef JSON_HPP
+#define JSON_HPP
+
+#include <cctype>
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <type_traits>
+
+#include "csv.hpp"
+
+namespace NP {
+
+	// Just enough JSON for the line-delimited requests and responses of
+	// `nptest --serve`: flat objects whose fields are null, booleans,
+	// numbers, or strings.
+	namespace JSON {
+
+		class Value
+		{
+			public:
+
+			enum Kind { null, boolean, number, string };
+
+			Value()
+			: kind(null)
+			, flag(false)
+			, num(0)
+			{
+			}
+
+			Value(bool b)
+			: kind(boolean)
+			, flag(b)
+			, num(0)
+			{
+			}
+
+			Value(double x)
+			: kind(number)
+			, flag(false)
+			, num(x)
+			{
+			}
+
+			Value(const std::string& s)
+			: kind(string)
+			, flag(false)
+			, num(0)
+			, str(s)
+			{
+			}
+
+			Value(const char* s)
+			: Value(std::string(s))
+			{
+			}
+
+			Kind type() const
+			{
+				return kind;
+			}
+
+			bool as_bool() const
+			{
+				return flag;
+			}
+
+			double as_number() const
+			{
+				return num;
+			}
+
+			const std::string& as_string() const
+			{
+				return str;
+			}
+
+			private:
+
+			Kind kind;
+			bool flag;
+			double num;
+			std::string str;
+		};
+
+		typedef std::map<std::string, Value> Object;
+
+		// Reads a flat object from [begin, end). Syntax errors are reported
+		// as Parse_errors at the given line of the given file.
+		class Reader
+		{
+			public:
+
+			Reader(const char* begin, const char* end,
+			       const std::string& file = "", std::size_t line = 1)
+			: begin(begin)
+			, pos(begin)
+			, end(end)
+			, file(file)
+			, line(line)
+			{
+			}
+
+			Object object()
+			{
+				Object obj;
+				expect('{');
+				if (peek() == '}') {
+					pos++;
+				} else {
+					do {
+						skip_blanks();
+						auto name = string();
+						expect(':');
+						if (obj.count(name))
+							fail(pos, "duplicate field '" + name + "'");
+						obj[name] = value();
+					} while (accept(','));
+					expect('}');
+				}
+				if (peek() != '\0')
+					fail(pos, "unexpected text after the object");
+				return obj;
+			}
+
+			private:
+
+			const char* begin;
+			const char* pos;
+			const char* end;
+			std::string file;
+			std::size_t line;
+
+			[[noreturn]] void fail(const char* where, const std::string& problem)
+			{
+				throw Parse_error(file, line, where - begin + 1, problem);
+			}
+
+			void skip_blanks()
+			{
+				while (pos != end && (*pos == ' ' || *pos == '\t'
+				                      || *pos == '\r' || *pos == '\n'))
+					pos++;
+			}
+
+			// the next non-blank character, or '\0' at the end
+			char peek()
+			{
+				skip_blanks();
+				return pos == end ? '\0' : *pos;
+			}
+
+			bool accept(char c)
+			{
+				if (peek() != c)
+					return false;
+				pos++;
+				return true;
+			}
+
+			void expect(char c)
+			{
+				if (!accept(c))
+					fail(pos, std::string("expected '") + c + "'");
+			}
+
+			bool keyword(const char* word)
+			{
+				auto n = std::strlen(word);
+				if ((std::size_t) (end - pos) < n || std::strncmp(pos, word, n))
+					return false;
+				pos += n;
+				return true;
+			}
+
+			Value value()
+			{
+				const char* start = pos;
+				switch (peek()) {
+				case '"':
+					return Value(string());
+				case '{':
+				case '[':
+					fail(pos, "nested objects and arrays are not supported");
+				default:
+					if (keyword("null"))
+						return Value();
+					if (keyword("true"))
+						return Value(true);
+					if (keyword("false"))
+						return Value(false);
+					return Value(number(start));
+				}
+			}
+
+			double number(const char* start)
+			{
+				const char* token_end = pos;
+				while (token_end != end
+				       && std::strchr("+-.0123456789eE", *token_end))
+					token_end++;
+				std::string token(pos, token_end);
+				char* parsed_end;
+				errno = 0;
+				double value = std::strtod(token.c_str(), &parsed_end);
+				if (token.empty() || parsed_end != token.c_str() + token.size())
+					fail(start, "expected a value");
+				if (errno == ERANGE && std::isinf(value))
+					fail(start, "number out of range");
+				pos = token_end;
+				return value;
+			}
+
+			std::string string()
+			{
+				if (pos == end || *pos != '"')
+					fail(pos, "expected a string");
+				pos++;
+				std::string s;
+				while (true) {
+					if (pos == end)
+						fail(pos, "unterminated string");
+					char c = *pos++;
+					if (c == '"')
+						return s;
+					if ((unsigned char) c < 0x20)
+						fail(pos - 1, "control character in string");
+					if (c != '\\') {
+						s += c;
+						continue;
+					}
+					if (pos == end)
+						fail(pos, "unterminated string");
+					switch (*pos++) {
+					case '"':  s += '"';  break;
+					case '\\': s += '\\'; break;
+					case '/':  s += '/';  break;
+					case 'b':  s += '\b'; break;
+					case 'f':  s += '\f'; break;
+					case 'n':  s += '\n'; break;
+					case 'r':  s += '\r'; break;
+					case 't':  s += '\t'; break;
+					case 'u':  code_point(s); break;
+					default:
+						fail(pos - 1, "invalid escape sequence");
+					}
+				}
+			}
+
+			unsigned int hex4()
+			{
+				unsigned int u = 0;
+				for (int i = 0; i < 4; i++, pos++) {
+					if (pos == end || !std::isxdigit((unsigned char) *pos))
+						fail(pos, "invalid \\u escape");
+					u = 16 * u + (std::isdigit((unsigned char) *pos)
+					              ? *pos - '0'
+					              : std::tolower((unsigned char) *pos) - 'a' + 10);
+				}
+				return u;
+			}
+
+			// appends the \u escape (possibly a surrogate pair) as UTF-8
+			void code_point(std::string& s)
+			{
+				unsigned long u = hex4();
+				if (u >= 0xd800 && u < 0xdc00 && keyword("\\u")) {
+					unsigned long low = hex4();
+					if (low < 0xdc00 || low >= 0xe000)
+						fail(pos, "invalid surrogate pair");
+					u = 0x10000 + ((u - 0xd800) << 10) + (low - 0xdc00);
+				}
+				if (u < 0x80) {
+					s += (char) u;
+				} else if (u < 0x800) {
+					s += (char) (0xc0 | (u >> 6));
+					s += (char) (0x80 | (u & 0x3f));
+				} else if (u < 0x10000) {
+					s += (char) (0xe0 | (u >> 12));
+					s += (char) (0x80 | ((u >> 6) & 0x3f));
+					s += (char) (0x80 | (u & 0x3f));
+				} else {
+					s += (char) (0xf0 | (u >> 18));
+					s += (char) (0x80 | ((u >> 12) & 0x3f));
+					s += (char) (0x80 | ((u >> 6) & 0x3f));
+					s += (char) (0x80 | (u & 0x3f));
+				}
+			}
+		};
+
+		inline Object parse_object(const std::string& text,
+		                           const std::string& file = "",
+		                           std::size_t line = 1)
+		{
+			Reader r(text.data(), text.data() + text.size(), file, line);
+			return r.object();
+		}
+
+		inline void write(std::ostream& out, const std::string& s)
+		{
+			static const char hex[] = "0123456789abcdef";
+			out << '"';
+			for (char c : s) {
+				switch (c) {
+				case '"':  out << "\\\""; break;
+				case '\\': out << "\\\\"; break;
+				case '\n': out << "\\n";  break;
+				case '\r': out << "\\r";  break;
+				case '\t': out << "\\t";  break;
+				default:
+					if ((unsigned char) c < 0x20)
+						out << "\\u00" << hex[c >> 4] << hex[c & 0xf];
+					else
+						out << c;
+				}
+			}
+			out << '"';
+		}
+
+		inline void write(std::ostream& out, const char* s)
+		{
+			write(out, std::string(s));
+		}
+
+		inline void write(std::ostream& out, bool b)
+		{
+			out << (b ? "true" : "false");
+		}
+
+		// numbers that JSON cannot represent become null
+		inline void write(std::ostream& out, double x)
+		{
+			if (!std::isfinite(x)) {
+				out << "null";
+				return;
+			}
+			std::ostringstream s;
+			s.precision(std::numeric_limits<double>::digits10);
+			s << x;
+			out << s.str();
+		}
+
+		inline void write(std::ostream& out, long long x)
+		{
+			out << x;
+		}
+
+		inline void write(std::ostream& out, unsigned long long x)
+		{
+			out << x;
+		}
+
+		inline void write(std::ostream& out, const Value& v)
+		{
+			switch (v.type()) {
+			case Value::boolean:
+				write(out, v.as_bool());
+				break;
+			case Value::number:
+				write(out, v.as_number());
+				break;
+			case Value::string:
+				write(out, v.as_string());
+				break;
+			default:
+				out << "null";
+			}
+		}
+
+		// Writes a flat object one field at a time. The object is closed
+		// when the writer goes out of scope.
+		class Writer
+		{
+			public:
+
+			Writer(std::ostream& out)
+			: out(out)
+			, first(true)
+			{
+				out << '{';
+			}
+
+			~Writer()
+			{
+				out << '}';
+			}
+
+			template<typename T>
+			Writer& field(const std::string& name, const T& value)
+			{
+				if (!first)
+					out << ", ";
+				first = false;
+				write(out, name);
+				out << ": ";
+				write_value(value);
+				return *this;
+			}
+
+			private:
+
+			std::ostream& out;
+			bool first;
+
+			template<typename T>
+			void write_value(const T& value)
+			{
+				write_value(value, std::is_integral<T>());
+			}
+
+			void write_value(const bool& b)
+			{
+				write(out, b);
+			}
+
+			template<typename T>
+			void write_value(const T& value, std::true_type)
+			{
+				if (std::is_signed<T>::value)
+					write(out, (long long) value);
+				else
+					write(out, (unsigned long long) value);
+			}
+
+			template<typename T>
+			void write_value(const T& value, std::false_type)
+			{
+				write(out, value);
+			}
+
+			Writer(const Writer&) = delete;
+		};
+	}
+}
+
+#endif
@@ -1,6 +1,10 @@
 #ifndef PRECEDENCE_HPP
 #define PRECEDENCE_HPP
 
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
 #include "jobs.hpp"
 
 namespace NP {
@@ -8,14 +12,212 @@ namespace NP {
 	typedef std::pair<JobID, JobID> Precedence_constraint;
 	typedef std::vector<Precedence_constraint> Precedence_constraints;
 
+	inline void validate_prec_refs(const Precedence_constraints& dag,
+	                               const Job_id_map& index)
+	{
+		for (const auto& constraint : dag) {
+			index.index_of(constraint.first);
+			index.index_of(constraint.second);
+		}
+	}
+
 	template<class Time>
 	void validate_prec_refs(const Precedence_constraints& dag,
-	                        const typename Job<Time>::Job_set jobs)
+	                        const typename Job<Time>::Job_set& jobs)
+	{
+		validate_prec_refs(dag, Job_id_map(jobs));
+	}
+
+	// What preprocess_precedence() found out about a set of precedence
+	// constraints.
+	struct Precedence_summary
+	{
+		// number of constraints as given...
+		std::size_t given_edges;
+		// ... and how many of them were dropped because they are
+		// duplicates or implied by other constraints (if asked to)
+		std::size_t redundant_edges;
+
+		// If the constraints are cyclic, the jobs of one cycle (each
+		// job is a predecessor of the next one, and the last one of the
+		// first one). Empty if the constraints form a DAG.
+		std::vector<JobID> cycle;
+
+		// The position of each job (by index in the workload) in a
+		// topological order of the constraints. Empty if there are no
+		// constraints or if they are cyclic.
+		std::vector<std::uint32_t> topological_rank;
+
+		Precedence_summary()
+		: given_edges(0)
+		, redundant_edges(0)
+		{
+		}
+
+		bool is_acyclic() const
+		{
+			return cycle.empty();
+		}
+
+		std::size_t remaining_edges() const
+		{
+			return given_edges - redundant_edges;
+		}
+	};
+
+	// Prepares the precedence constraints of a workload for the analysis
+	// engines. If the constraints are cyclic, one cycle is reported in
+	// the summary, and the constraints are left as they are (no schedule
+	// can satisfy them, which the analyses find out by themselves).
+	// Otherwise, (1) the topological rank of each job is reported in the
+	// summary, (2) if drop_redundant is set, the constraints that are
+	// implied by others (and duplicates) are removed (i.e., the
+	// transitive reduction is computed), and (3) the remaining ones are
+	// ordered by successor and then by predecessor in reverse topological
+	// order. The engines build their predecessor lists in this order, so
+	// they find the predecessors that are dispatched last first when they
+	// check whether a job is ready.
+	//
+	// NOTE: The global analysis bounds when a job is ready by the finish
+	//       times of each of its predecessors, as far as they are known,
+	//       so dropping implied constraints can change its results.
+	//       Reordering the constraints does not change the results of
+	//       either analysis.
+	//
+	// Assumes valid job references.
+	template<class Time>
+	Precedence_summary preprocess_precedence(
+		Precedence_constraints& dag,
+		const typename Job<Time>::Job_set& jobs,
+		const Job_id_map& index,
+		bool drop_redundant = false)
 	{
-		for (auto constraint : dag) {
-			lookup<Time>(jobs, constraint.first);
-			lookup<Time>(jobs, constraint.second);
+		Precedence_summary summary;
+		summary.given_edges = dag.size();
+
+		if (dag.empty())
+			return summary;
+
+		const std::size_t n = jobs.size();
+
+		typedef std::pair<std::size_t, std::size_t> Edge;
+		std::vector<Edge> edges;
+		edges.reserve(dag.size());
+		for (const auto& e : dag)
+			edges.emplace_back(index.index_of(e.first),
+			                   index.index_of(e.second));
+
+		// the successors of job i are succ[first_succ[i]..first_succ[i+1])
+		std::vector<std::size_t> first_succ(n + 1, 0), succ(edges.size());
+		for (const auto& e : edges)
+			first_succ[e.first + 1]++;
+		for (std::size_t i = 0; i < n; i++)
+			first_succ[i + 1] += first_succ[i];
+		{
+			auto next = first_succ;
+			for (const auto& e : edges)
+				succ[next[e.first]++] = e.second;
+		}
+
+		// topological order (Kahn's algorithm)
+		std::vector<std::size_t> in_degree(n, 0), order;
+		order.reserve(n);
+		for (const auto& e : edges)
+			in_degree[e.second]++;
+		for (std::size_t i = 0; i < n; i++)
+			if (!in_degree[i])
+				order.push_back(i);
+		for (std::size_t k = 0; k < order.size(); k++) {
+			auto i = order[k];
+			for (auto s = first_succ[i]; s < first_succ[i + 1]; s++)
+				if (!--in_degree[succ[s]])
+					order.push_back(succ[s]);
 		}
+
+		if (order.size() < n) {
+			// Each job left over has a predecessor that is left over,
+			// too, so walking backwards from any of them must run into
+			// a cycle.
+			std::vector<std::size_t> left_over_pred(n, n);
+			for (const auto& e : edges)
+				if (in_degree[e.first])
+					left_over_pred[e.second] = e.first;
+			std::size_t i = 0;
+			while (!in_degree[i])
+				i++;
+			std::vector<std::size_t> seen_at(n, n), path;
+			while (seen_at[i] == n) {
+				seen_at[i] = path.size();
+				path.push_back(i);
+				i = left_over_pred[i];
+			}
+			// path[seen_at[i]..] is the cycle, backwards
+			for (auto k = path.size(); k > seen_at[i]; k--)
+				summary.cycle.push_back(jobs[path[k - 1]].get_id());
+			return summary;
+		}
+
+		// the position of each job in the topological order
+		auto& rank = summary.topological_rank;
+		rank.resize(n);
+		for (std::size_t k = 0; k < n; k++)
+			rank[order[k]] = k;
+
+		if (drop_redundant) {
+			// Transitive reduction: the edge u -> w is implied iff w can
+			// be reached from another successor v of u. Such a v precedes
+			// w in the topological order, so visiting u's successors in
+			// that order and marking everything reachable from them finds
+			// all implied edges. Jobs after u's last successor cannot
+			// reach any of u's successors, so the search is cut off there.
+			for (std::size_t u = 0; u < n; u++)
+				std::sort(succ.begin() + first_succ[u],
+				          succ.begin() + first_succ[u + 1],
+				          [&] (std::size_t a, std::size_t b) {
+				              return rank[a] < rank[b];
+				          });
+
+			std::vector<std::size_t> reached_from(n, n), stack;
+			edges.clear();
+			for (std::size_t u = 0; u < n; u++) {
+				if (first_succ[u] == first_succ[u + 1])
+					continue;
+				auto limit = rank[succ[first_succ[u + 1] - 1]];
+				for (auto s = first_succ[u]; s < first_succ[u + 1]; s++) {
+					auto v = succ[s];
+					if (reached_from[v] == u)
+						continue; // implied (or a duplicate)
+					edges.emplace_back(u, v);
+					reached_from[v] = u;
+					stack.push_back(v);
+					while (!stack.empty()) {
+						auto x = stack.back();
+						stack.pop_back();
+						for (auto t = first_succ[x]; t < first_succ[x + 1]; t++) {
+							auto y = succ[t];
+							if (rank[y] <= limit && reached_from[y] != u) {
+								reached_from[y] = u;
+								stack.push_back(y);
+							}
+						}
+					}
+				}
+			}
+		}
+
+		std::sort(edges.begin(), edges.end(),
+			[&] (const Edge& a, const Edge& b) {
+				return rank[a.second] < rank[b.second]
+				       || (a.second == b.second
+				           && rank[a.first] > rank[b.first]);
+			});
+
+		dag.clear();
+		for (const auto& e : edges)
+			dag.emplace_back(jobs[e.first].get_id(), jobs[e.second].get_id());
+		summary.redundant_edges = summary.given_edges - dag.size();
+
+		return summary;
 	}
 
 }
@@ -1,6 +1,8 @@
 #ifndef NP_PROBLEM_HPP
 #define NP_PROBLEM_HPP
 
+#include <utility>
+
 #include "jobs.hpp"
 #include "precedence.hpp"
 #include "aborts.hpp"
@@ -22,20 +24,34 @@ namespace NP {
 		// (3) abort actions for (some of) the jobs
 		Abort_actions aborts;
 
+		// positions of the jobs in the workload, by ID
+		Job_id_map job_index;
+
+		// what preprocessing the precedence constraints found out (see
+		// preprocess_precedence())
+		Precedence_summary precedence;
+
 		// ** Platform model:
 		// on how many (identical) processors are the jobs being
 		// dispatched (globally, in priority order)
 		unsigned int num_processors;
 
+		// NOTE: The constructors take the workload description by value
+		//       and move it into place, so pass temporaries (or use
+		//       std::move) to avoid copying large job sets.
+
 		// Classic default setup: no abort actions
 		Scheduling_problem(Workload jobs, Precedence_constraints dag,
 		                   unsigned int num_processors = 1)
 		: num_processors(num_processors)
-		, jobs(jobs)
-		, dag(dag)
+		, jobs(std::move(jobs))
+		, dag(std::move(dag))
+		, job_index(this->jobs)
 		{
 			assert(num_processors > 0);
-			validate_prec_refs<Time>(dag, jobs);
+			validate_prec_refs(this->dag, job_index);
+			precedence = preprocess_precedence<Time>(this->dag, this->jobs,
+			                                         job_index);
 		}
 
 		// Full constructor with abort actions
@@ -43,23 +59,40 @@ namespace NP {
 		                   Abort_actions aborts,
 		                   unsigned int num_processors)
 		: num_processors(num_processors)
-		, jobs(jobs)
-		, dag(dag)
-		, aborts(aborts)
+		, jobs(std::move(jobs))
+		, dag(std::move(dag))
+		, aborts(std::move(aborts))
+		, job_index(this->jobs)
 		{
 			assert(num_processors > 0);
-			validate_prec_refs<Time>(dag, jobs);
-			validate_abort_refs<Time>(aborts, jobs);
+			validate_prec_refs(this->dag, job_index);
+			precedence = preprocess_precedence<Time>(this->dag, this->jobs,
+			                                         job_index);
+			validate_abort_refs<Time>(this->aborts, this->jobs, job_index);
 		}
 
 		// Convenience constructor: no DAG, no abort actions
 		Scheduling_problem(Workload jobs,
 		                   unsigned int num_processors = 1)
-		: jobs(jobs)
+		: jobs(std::move(jobs))
+		, job_index(this->jobs)
 		, num_processors(num_processors)
 		{
 			assert(num_processors > 0);
 		}
+
+		// Drops the precedence constraints that are duplicates or implied
+		// by others (see preprocess_precedence()). Off by default, since
+		// it can change the results of the global analysis.
+		void drop_redundant_precedence()
+		{
+			precedence = preprocess_precedence<Time>(dag, jobs, job_index,
+			                                         true);
+		}
+
+		// movable, but no accidental copies
+		Scheduling_problem(Scheduling_problem&& origin) = default;
+		Scheduling_problem(const Scheduling_problem& origin) = delete;
 	};
 
 	// Common options to pass to the analysis engines
@@ -86,12 +119,37 @@ namespace NP {
 		// of the main workload index be?
 		std::size_t num_buckets;
 
+		// Should the states of each exploration depth (and the sets of
+		// scheduled jobs they reference) be allocated from a per-depth
+		// arena that is released in one go once the depth is done?
+		bool use_arenas;
+
+		// Should the uniprocessor analysis use the parallel breadth-first
+		// explorer? (Only available if CONFIG_PARALLEL is set, in which
+		// case the global analysis is always parallel.)
+		bool parallel;
+
+		// Should the parallel global analysis yield exactly the same
+		// results as a sequential run, no matter how many threads are
+		// used? (Only relevant if CONFIG_PARALLEL is set; sequential
+		// analyses are deterministic anyway.)
+		bool deterministic;
+
+		// Should the timeout (and the reported CPU time) refer to the
+		// elapsed wall-clock time of the analysis instead of the CPU time
+		// of the process? (For analyses that run alongside others.)
+		bool use_wall_clock;
+
 		Analysis_options()
 		: timeout(0)
 		, max_depth(0)
 		, early_exit(true)
 		, num_buckets(1000)
 		, be_naive(false)
+		, use_arenas(true)
+		, parallel(false)
+		, deterministic(false)
+		, use_wall_clock(false)
 		{
 		}
 	};
@@ -0,0 +1,117 @@
+#ifndef RESPONSE_TIMES_HPP
+#define RESPONSE_TIMES_HPP
+
+#include <cstddef>
+#include <cassert>
+#include <algorithm>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "interval.hpp"
+#include "time.hpp"
+
+namespace NP {
+
+	// Bounds on the finish times of all jobs of a workload, indexed by
+	// the jobs' positions in the workload. Updating a bound is just a
+	// min and a max, without any hashing. The lower and upper bounds
+	// are kept in separate arrays so that whole tables can be combined
+	// with plain min/max loops, which compilers vectorize.
+	template<class Time>
+	class Response_times
+	{
+		public:
+
+		Response_times(std::size_t num_jobs = 0)
+		: lower(num_jobs, no_lower_bound())
+		, upper(num_jobs, no_upper_bound())
+		{
+		}
+
+		std::size_t size() const
+		{
+			return lower.size();
+		}
+
+		// widen the bounds of job j to include the given range; returns
+		// true if they changed
+		bool update(std::size_t j, const Interval<Time>& range)
+		{
+			bool widened = range.min() < lower[j] || range.max() > upper[j];
+			lower[j] = std::min(lower[j], range.min());
+			upper[j] = std::max(upper[j], range.max());
+			return widened;
+		}
+
+		// forget the bounds of job j (to undo updates)
+		void reset(std::size_t j)
+		{
+			lower[j] = no_lower_bound();
+			upper[j] = no_upper_bound();
+		}
+
+		// replace the bounds of job j (to undo updates)
+		void reset(std::size_t j, const Interval<Time>& range)
+		{
+			lower[j] = range.min();
+			upper[j] = range.max();
+		}
+
+		// were the bounds of job j ever updated?
+		bool contains(std::size_t j) const
+		{
+			return lower[j] <= upper[j];
+		}
+
+		// assumes contains(j)
+		Interval<Time> operator[](std::size_t j) const
+		{
+			assert(contains(j));
+			return Interval<Time>{lower[j], upper[j]};
+		}
+
+		// widen all bounds to include the bounds in other
+		void merge(const Response_times& other)
+		{
+			assert(other.size() == size());
+
+			Time* lo = lower.data();
+			Time* hi = upper.data();
+			const Time* other_lo = other.lower.data();
+			const Time* other_hi = other.upper.data();
+			const std::size_t n = size();
+
+			for (std::size_t i = 0; i < n; i++)
+				lo[i] = std::min(lo[i], other_lo[i]);
+			for (std::size_t i = 0; i < n; i++)
+				hi[i] = std::max(hi[i], other_hi[i]);
+		}
+
+		private:
+
+		// Jobs without bounds have an empty (inverted) interval, which
+		// any update or merge simply overwrites.
+		static Time no_lower_bound()
+		{
+			return Time_model::constants<Time>::infinity();
+		}
+
+		static Time no_upper_bound()
+		{
+			return std::numeric_limits<Time>::lowest();
+		}
+
+		std::vector<Time> lower;
+		std::vector<Time> upper;
+	};
+
+	// A list of updates of a response-time table (by job index), for
+	// when only few jobs are affected and a whole table would be too
+	// expensive to clear and combine.
+	template<class Time>
+	using Finish_time_updates = std::vector<std::pair<std::size_t, Interval<Time>>>;
+
+}
+
+#endif
@@ -0,0 +1,184 @@
+#ifndef SHARDED_CACHE_HPP
+#define SHARDED_CACHE_HPP
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <memory>
+#include <vector>
+#include <forward_list>
+#include <unordered_map>
+
+#include "tbb/parallel_for.h"
+#include "tbb/blocked_range.h"
+
+#include "jobs.hpp"
+
+namespace NP {
+
+	// A concurrent map from state keys to lists of states, as needed by
+	// the parallel exploration to find merge candidates.
+	//
+	// The key space is split into a fixed number of shards. Each shard is
+	// an open-addressing table whose slots are claimed with a single CAS
+	// on the key, so looking up or creating an entry never blocks other
+	// keys. Each entry has its own spin lock, which is held only while the
+	// caller works on that entry's list. Keys that do not find a slot
+	// within a few probes (e.g., because a depth turned out to be much
+	// wider than expected) spill into a small mutex-protected overflow
+	// map of their shard.
+	//
+	// The tables are sized anew for each depth (see reset()), so they
+	// never need to be resized while in use.
+	template<class Ref>
+	class Sharded_cache
+	{
+		public:
+
+		typedef std::forward_list<Ref> Refs;
+
+		static const std::size_t num_shards = 64;
+		static const std::size_t max_probes = 16;
+		static const std::size_t min_slots_per_shard = 16;
+
+		Sharded_cache()
+		: shards(num_shards)
+		{
+			for (auto& s : shards)
+				s.resize(min_slots_per_shard);
+		}
+
+		// Remove all entries and make room for the expected number of
+		// distinct keys. Not thread-safe.
+		void reset(std::size_t expected_keys)
+		{
+			// keep the load factor of the tables below one half
+			std::size_t n = min_slots_per_shard;
+			while (n < 2 * expected_keys / num_shards)
+				n *= 2;
+
+			tbb::parallel_for(tbb::blocked_range<std::size_t>(0, num_shards),
+				[&] (const tbb::blocked_range<std::size_t>& r) {
+					for (auto i = r.begin(); i != r.end(); i++)
+						shards[i].resize(n);
+				});
+		}
+
+		// Calls f(refs) with the list of references for the given key
+		// (empty if the key was not seen before) while holding the
+		// entry's lock, and returns what f returns.
+		template<typename F>
+		auto with_entry(hash_value_t key, F f) -> decltype(f(std::declval<Refs&>()))
+		{
+			Entry& e = shards[shard_of(key)].find_or_create(key);
+			Entry_lock lock(e);
+			return f(e.refs);
+		}
+
+		// number of keys that did not fit into the tables
+		std::size_t number_of_overflows() const
+		{
+			std::size_t n = 0;
+			for (const auto& s : shards)
+				n += s.overflow.size();
+			return n;
+		}
+
+		private:
+
+		struct Entry {
+			std::atomic<bool> locked;
+			Refs refs;
+
+			Entry() : locked(false) {}
+		};
+
+		struct Entry_lock {
+			Entry& e;
+
+			Entry_lock(Entry& e) : e(e)
+			{
+				while (e.locked.exchange(true, std::memory_order_acquire))
+					while (e.locked.load(std::memory_order_relaxed))
+						std::this_thread::yield();
+			}
+
+			~Entry_lock()
+			{
+				e.locked.store(false, std::memory_order_release);
+			}
+		};
+
+		// marks a free slot; keys equal to it go to the overflow map
+		static const hash_value_t no_key = 0;
+
+		struct Slot {
+			std::atomic<hash_value_t> key;
+			Entry entry;
+
+			Slot() : key(no_key) {}
+		};
+
+		struct Shard {
+			std::unique_ptr<Slot[]> slots;
+			std::size_t mask;
+
+			std::mutex overflow_lock;
+			std::unordered_map<hash_value_t, Entry> overflow;
+
+			Shard() : mask(0) {}
+
+			void resize(std::size_t n)
+			{
+				if (mask + 1 != n) {
+					slots.reset(new Slot[n]);
+					mask = n - 1;
+				} else {
+					for (std::size_t i = 0; i < n; i++) {
+						slots[i].key.store(no_key, std::memory_order_relaxed);
+						slots[i].entry.refs.clear();
+					}
+				}
+				overflow.clear();
+			}
+
+			Entry& find_or_create(hash_value_t key)
+			{
+				if (key != no_key)
+					for (std::size_t p = 0; p < max_probes; p++) {
+						Slot& s = slots[(key + p) & mask];
+						hash_value_t k = s.key.load(std::memory_order_acquire);
+						if (k == no_key &&
+						    s.key.compare_exchange_strong(k, key,
+						                                  std::memory_order_acq_rel))
+							// we claimed this slot
+							return s.entry;
+						// either already taken, or we lost the race
+						if (k == key)
+							return s.entry;
+					}
+
+				// no luck, use the overflow map
+				std::lock_guard<std::mutex> guard(overflow_lock);
+				return overflow[key];
+			}
+		};
+
+		std::vector<Shard> shards;
+
+		static std::size_t shard_of(hash_value_t key)
+		{
+			// the low bits select the slot, so use the high bits here
+			return (key >> 58) % num_shards;
+		}
+
+		public:
+
+		// movable, but no accidental copies
+		Sharded_cache(Sharded_cache&& origin) = default;
+		Sharded_cache(const Sharded_cache& origin) = delete;
+	};
+
+}
+
+#endif
@@ -0,0 +1,161 @@
+#ifndef SORTED_INDEX_HPP
+#define SORTED_INDEX_HPP
+
+#include <cstddef>
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "jobs.hpp"
+
+namespace NP {
+
+	// An immutable sequence of (key, value) pairs sorted by key, for the
+	// job indices that the state spaces build once and then only scan
+	// from some lower or upper bound onwards. Entries with equal keys
+	// keep the order in which they were given (as in a std::multimap).
+	//
+	// The entries are kept in one contiguous array, so that scans do not
+	// chase pointers. For the binary searches, a copy of the keys is kept
+	// in Eytzinger (BFS) order: the search then always descends to the
+	// left or the right child of the current node, which can be done
+	// without branches, and the first few levels of the implicit tree
+	// share a handful of cache lines.
+	template<class Key, class Value>
+	class Sorted_index
+	{
+		public:
+
+		typedef std::pair<Key, Value> Entry;
+		typedef typename std::vector<Entry>::const_iterator const_iterator;
+
+		Sorted_index()
+		: tree(1)
+		, rank(1)
+		{
+		}
+
+		Sorted_index(std::vector<Entry> unsorted)
+		: entries(std::move(unsorted))
+		, tree(entries.size() + 1)
+		, rank(entries.size() + 1)
+		{
+			std::stable_sort(entries.begin(), entries.end(),
+				[] (const Entry& a, const Entry& b) {
+					return a.first < b.first;
+				});
+			std::size_t next = 0;
+			layout(1, next);
+		}
+
+		std::size_t size() const
+		{
+			return entries.size();
+		}
+
+		bool empty() const
+		{
+			return entries.empty();
+		}
+
+		const Entry& operator[](std::size_t i) const
+		{
+			return entries[i];
+		}
+
+		const_iterator begin() const
+		{
+			return entries.begin();
+		}
+
+		const_iterator end() const
+		{
+			return entries.end();
+		}
+
+		// first entry with a key not less than k
+		const_iterator lower_bound(const Key& k) const
+		{
+			return search(k, [] (const Key& a, const Key& b) {
+				return a < b;
+			});
+		}
+
+		// first entry with a key greater than k
+		const_iterator upper_bound(const Key& k) const
+		{
+			return search(k, [] (const Key& a, const Key& b) {
+				return !(b < a);
+			});
+		}
+
+		private:
+
+		std::vector<Entry> entries;
+		// tree[1..n]: the keys in Eytzinger order (tree[0] is unused)
+		std::vector<Key> tree;
+		// rank[i]: the position of tree[i] in entries
+		std::vector<std::size_t> rank;
+
+		// fill the subtree rooted at node i with the next keys in order
+		void layout(std::size_t i, std::size_t& next)
+		{
+			if (i <= entries.size()) {
+				layout(2 * i, next);
+				tree[i] = entries[next].first;
+				rank[i] = next++;
+				layout(2 * i + 1, next);
+			}
+		}
+
+		// Returns the first entry whose key does not satisfy
+		// go_right(key, k), where go_right must be monotone in the key.
+		template<typename Pred>
+		const_iterator search(const Key& k, Pred go_right) const
+		{
+			const std::size_t n = entries.size();
+			const Key* t = tree.data();
+			std::size_t i = 1;
+			while (i <= n)
+				i = 2 * i + go_right(t[i], k);
+			// The last node where we went left is the answer. Going
+			// left appends a zero bit to i, so drop the trailing ones
+			// (the final right turns) and that zero.
+			i >>= trailing_ones(i) + 1;
+			return i ? entries.begin() + rank[i] : entries.end();
+		}
+
+		static unsigned int trailing_ones(std::size_t i)
+		{
+#if defined(__GNUC__) || defined(__clang__)
+			return __builtin_ctzll(~static_cast<unsigned long long>(i));
+#else
+			unsigned int n = 0;
+			while (i & 1) {
+				i >>= 1;
+				n++;
+			}
+			return n;
+#endif
+		}
+	};
+
+	template<class Time>
+	using Jobs_by_time = Sorted_index<Time, const Job<Time>*>;
+
+	// index the jobs by the given time attribute (e.g., by
+	// &Job<Time>::latest_arrival), in workload order among equal times
+	template<class Time>
+	Jobs_by_time<Time> sort_jobs_by(const typename Job<Time>::Job_set& jobs,
+	                                Time (Job<Time>::*time_of)() const)
+	{
+		std::vector<typename Jobs_by_time<Time>::Entry> entries;
+		entries.reserve(jobs.size());
+		for (const Job<Time>& j : jobs)
+			entries.emplace_back((j.*time_of)(), &j);
+		return Jobs_by_time<Time>(std::move(entries));
+	}
+
+}
+
+#endif
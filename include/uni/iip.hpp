@@ -39,10 +39,8 @@ namespace NP {
 
 			Precatious_RM_IIP(const Space &space, const Jobs &jobs)
 			: space(space), max_priority(highest_prio(jobs))
+			, hp_jobs(max_priority_jobs(jobs, max_priority))
 			{
-				for (const Job<Time>& j : jobs)
-					if (j.get_priority() == max_priority)
-						hp_jobs.insert({j.latest_arrival(), &j});
 				DM("IIP max priority = " << max_priority);
 			}
 
@@ -79,7 +77,8 @@ namespace NP {
 
 			const Space &space;
 			const Time max_priority;
-			std::multimap<Time, const Job<Time>*> hp_jobs;
+			// maximum-priority jobs by latest arrival
+			const Jobs_by_time<Time> hp_jobs;
 
 			static Time highest_prio(const Jobs &jobs)
 			{
@@ -89,6 +88,16 @@ namespace NP {
 				return prio;
 			}
 
+			static Jobs_by_time<Time> max_priority_jobs(const Jobs &jobs,
+			                                            Time max_priority)
+			{
+				std::vector<typename Jobs_by_time<Time>::Entry> entries;
+				for (const Job<Time>& j : jobs)
+					if (j.get_priority() == max_priority)
+						entries.emplace_back(j.latest_arrival(), &j);
+				return Jobs_by_time<Time>(std::move(entries));
+			}
+
 		};
 
 		template<class Time> class Critical_window_IIP
@@ -155,8 +164,7 @@ namespace NP {
 
 				// first, check everything that's already pending at time t
 				// is accounted for
-				for (auto it = space.jobs_by_earliest_arrival
-				                    .lower_bound(s.earliest_job_release());
+				for (auto it = space.first_pending_by_earliest_arrival(s);
 				     it != space.jobs_by_earliest_arrival.end()
 				     && it->second->earliest_arrival() <= at;
 				     it++) {
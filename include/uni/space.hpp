@@ -14,10 +14,20 @@
 #include <cassert>
 
 #include "config.h"
+
+#ifdef CONFIG_PARALLEL
+#include "tbb/parallel_for.h"
+#include "tbb/blocked_range.h"
+#include "tbb/task_arena.h"
+#endif
 #include "problem.hpp"
 #include "jobs.hpp"
 #include "precedence.hpp"
 #include "clock.hpp"
+#include "zobrist.hpp"
+#include "arena.hpp"
+#include "response_times.hpp"
+#include "sorted_index.hpp"
 
 #include "uni/state.hpp"
 
@@ -43,15 +53,24 @@ namespace NP {
 				// this is a uniprocessor analysis
 				assert(prob.num_processors == 1);
 
-				auto s = State_space(prob.jobs, prob.dag, prob.aborts,
+				auto s = State_space(prob.jobs, prob.job_index,
+				                     prob.dag, prob.aborts,
 				                     opts.timeout, opts.max_depth,
 				                     opts.num_buckets, opts.early_exit);
+				s.use_arenas = opts.use_arenas;
+				if (opts.use_wall_clock)
+					s.cpu_time = Processor_clock(Processor_clock::wall_clock_time);
 				s.cpu_time.start();
 				if (opts.be_naive)
 					s.explore_naively();
+#ifdef CONFIG_PARALLEL
+				else if (opts.parallel)
+					s.explore_in_parallel();
+#endif
 				else
 					s.explore();
 				s.cpu_time.stop();
+				s.track_arena_memory();
 				return s;
 			}
 
@@ -74,11 +93,11 @@ namespace NP {
 
 			Interval<Time> get_finish_times(const Job<Time>& j) const
 			{
-				auto rbounds = rta.find(j.get_id());
-				if (rbounds == rta.end()) {
+				auto i = job_index.find(j.get_id());
+				if (i == Job_id_map::npos || !rta.contains(i)) {
 					return Interval<Time>{0, Time_model::constants<Time>::infinity()};
 				} else {
-					return rbounds->second;
+					return rta[i];
 				}
 			}
 
@@ -107,6 +126,26 @@ namespace NP {
 				return width;
 			}
 
+			// number of times that a lookup in the state cache found a
+			// state with the same key, but different scheduled jobs
+			unsigned long number_of_key_collisions() const
+			{
+				return num_key_collisions;
+			}
+
+			// largest amount of memory (in bytes) held by the per-depth
+			// arenas at any one time (zero if arenas are not used)
+			std::size_t arena_memory_high_water() const
+			{
+				return arena_high_water;
+			}
+
+			// the uniprocessor analysis has no interval lookup table
+			Lookup_table_occupancy lookup_table_occupancy() const
+			{
+				return Lookup_table_occupancy();
+			}
+
 			double get_cpu_time() const
 			{
 				return cpu_time;
@@ -176,11 +215,13 @@ namespace NP {
 			typedef std::unordered_multimap<hash_value_t, State_ref> States_map;
 
 			typedef const Job<Time>* Job_ref;
-			typedef std::multimap<Time, Job_ref> By_time_map;
+			typedef Jobs_by_time<Time> By_time_map;
+			typedef typename By_time_map::const_iterator Job_iterator;
+			typedef Uniproc::Pending_jobs<Time> Pending_jobs;
 
 			typedef std::deque<State_ref> Todo_queue;
 
-			typedef std::unordered_map<JobID, Interval<Time> > Response_times;
+			typedef NP::Response_times<Time> Response_times;
 
 			typedef std::vector<std::size_t> Job_precedence_set;
 
@@ -198,6 +239,9 @@ namespace NP {
 
 			const Workload& jobs;
 
+			// positions of the jobs in the workload, by ID
+			const Job_id_map job_index;
+
 			std::vector<Job_precedence_set> job_precedence_sets;
 
 			By_time_map jobs_by_latest_arrival;
@@ -209,6 +253,21 @@ namespace NP {
 			States states;
 			unsigned long num_states, num_edges, width;
 			States_map states_by_key;
+			unsigned long num_key_collisions;
+
+			// random keys of the jobs (for the state lookup keys)
+			const Zobrist_keys job_keys;
+
+			// memory for the interned job sets, one arena per pool;
+			// declared before job_set_pools so that they outlive the pools
+			std::deque<Arena> arenas;
+			bool use_arenas;
+			std::size_t arena_high_water;
+
+			// interned sets of scheduled jobs, one pool per depth
+			// (starting at depth first_pool_depth)
+			std::deque<Job_set_pool> job_set_pools;
+			unsigned long first_pool_depth;
 
 			static const std::size_t num_todo_queues = 3;
 
@@ -225,21 +284,32 @@ namespace NP {
 			bool observed_deadline_miss;
 
 			State_space(const Workload& jobs,
+			            const Job_id_map& job_index,
 			            const Precedence_constraints &dag_edges,
 			            const Abort_actions& aborts,
 			            double max_cpu_time = 0,
 			            unsigned int max_depth = 0,
 			            std::size_t num_buckets = 1000,
 			            bool early_exit = true)
-			: jobs(jobs)
+			: rta(jobs.size())
+			, jobs(jobs)
 			, aborted(false)
 			, timed_out(false)
 			, timeout(max_cpu_time)
 			, max_depth(max_depth)
 			, iip(*this, jobs)
+			, job_index(job_index)
+			, jobs_by_latest_arrival(sort_jobs_by(jobs, &Job<Time>::latest_arrival))
+			, jobs_by_earliest_arrival(sort_jobs_by(jobs, &Job<Time>::earliest_arrival))
+			, jobs_by_deadline(sort_jobs_by(jobs, &Job<Time>::get_deadline))
 			, num_states(0)
 			, num_edges(0)
 			, width(0)
+			, num_key_collisions(0)
+			, job_keys(jobs.size())
+			, use_arenas(true)
+			, arena_high_water(0)
+			, first_pool_depth(0)
 			, todo_idx(0)
 			, current_job_count(0)
 			, job_precedence_sets(jobs.size())
@@ -247,19 +317,13 @@ namespace NP {
 			, observed_deadline_miss(false)
 			, abort_actions(jobs.size(), NULL)
 			{
-				for (const Job<Time>& j : jobs) {
-					jobs_by_latest_arrival.insert({j.latest_arrival(), &j});
-					jobs_by_earliest_arrival.insert({j.earliest_arrival(), &j});
-					jobs_by_deadline.insert({j.get_deadline(), &j});
-				}
 				for (auto e : dag_edges) {
-					const Job<Time>& from = lookup<Time>(jobs, e.first);
-					const Job<Time>& to   = lookup<Time>(jobs, e.second);
-					job_precedence_sets[index_of(to)].push_back(index_of(from));
+					auto from = job_index.index_of(e.first);
+					auto to   = job_index.index_of(e.second);
+					job_precedence_sets[to].push_back(from);
 				}
 				for (const Abort_action<Time>& a : aborts) {
-					const Job<Time>& j = lookup<Time>(jobs, a.get_id());
-					abort_actions[index_of(j)] = &a;
+					abort_actions[job_index.index_of(a.get_id())] = &a;
 				}
 			}
 
@@ -275,18 +339,12 @@ namespace NP {
 
 			void update_finish_times(const Job<Time>& j, Interval<Time> range)
 			{
-				auto rbounds = rta.find(j.get_id());
-				if (rbounds == rta.end()) {
-					rta.emplace(j.get_id(), range);
-					if (j.exceeds_deadline(range.upto()))
-						observed_deadline_miss = true;
-				} else {
-					rbounds->second.widen(range);
-					if (j.exceeds_deadline(rbounds->second.upto()))
-						observed_deadline_miss = true;
-				}
+				auto i = index_of(j);
+				rta.update(i, range);
+				if (j.exceeds_deadline(range.upto()))
+					observed_deadline_miss = true;
 				DM("      New finish time range for " << j
-				   << ": " << rta.find(j.get_id())->second << std::endl);
+				   << ": " << rta[i] << std::endl);
 
 				if (early_exit && observed_deadline_miss)
 					aborted = true;
@@ -297,6 +355,11 @@ namespace NP {
 				return (std::size_t) (&j - &(jobs[0]));
 			}
 
+			hash_value_t job_key(const Job<Time>& j) const
+			{
+				return job_keys[index_of(j)];
+			}
+
 			bool incomplete(const Scheduled &scheduled, const Job<Time>& j) const
 			{
 				return !scheduled.contains(index_of(j));
@@ -309,11 +372,19 @@ namespace NP {
 
 			// find next time by which a job is certainly released
 			Time next_certain_job_release(const State& s)
+			{
+				return s.next_certain_job_release([&] () {
+					return find_next_certain_job_release(s);
+				});
+			}
+
+			Time find_next_certain_job_release(const State& s)
 			{
 				const Scheduled &already_scheduled = s.get_scheduled_jobs();
 
-				for (auto it = jobs_by_latest_arrival
-				               .lower_bound(s.earliest_finish_time());
+				for (auto it = std::max(first_pending_by_latest_arrival(s),
+				                        jobs_by_latest_arrival
+				                        .lower_bound(s.earliest_finish_time()));
 				     it != jobs_by_latest_arrival.end(); it++) {
 					const Job<Time>& j = *(it->second);
 
@@ -350,8 +421,9 @@ namespace NP {
 				const Job<Time>& reference_job)
 			{
 
-				for (auto it = jobs_by_latest_arrival
-				               .lower_bound(s.earliest_finish_time());
+				for (auto it = std::max(first_pending_by_latest_arrival(s),
+				                        jobs_by_latest_arrival
+				                        .lower_bound(s.earliest_finish_time()));
 				     it != jobs_by_latest_arrival.end(); it++) {
 					const Job<Time>& j = *(it->second);
 
@@ -375,8 +447,7 @@ namespace NP {
 // Iterate over all incomplete jobs in state ppj_macro_local_s.
 // ppj_macro_local_j is of type const Job<Time>*
 #define foreach_possibly_pending_job(ppj_macro_local_s, ppj_macro_local_j) 	\
-	for (auto ppj_macro_local_it = jobs_by_earliest_arrival			\
-                     .lower_bound((ppj_macro_local_s).earliest_job_release()); \
+	for (auto ppj_macro_local_it = first_pending_by_earliest_arrival(ppj_macro_local_s); \
 	     ppj_macro_local_it != jobs_by_earliest_arrival.end() 				\
 	        && (ppj_macro_local_j = ppj_macro_local_it->second); 	\
 	     ppj_macro_local_it++) \
@@ -384,8 +455,7 @@ namespace NP {
 
 // Iterate over all incomplete jobs that are released no later than ppju_macro_local_until
 #define foreach_possbly_pending_job_until(ppju_macro_local_s, ppju_macro_local_j, ppju_macro_local_until) 	\
-	for (auto ppju_macro_local_it = jobs_by_earliest_arrival			\
-                     .lower_bound((ppju_macro_local_s).earliest_job_release()); \
+	for (auto ppju_macro_local_it = first_pending_by_earliest_arrival(ppju_macro_local_s); \
 	     ppju_macro_local_it != jobs_by_earliest_arrival.end() 				\
 	        && (ppju_macro_local_j = ppju_macro_local_it->second, ppju_macro_local_j->earliest_arrival() <= (ppju_macro_local_until)); 	\
 	     ppju_macro_local_it++) \
@@ -433,31 +503,53 @@ namespace NP {
 				return false;
 			}
 
-			Time earliest_possible_job_release(
-				const State& s,
-				const Job<Time>& ignored_job)
+			// the position of the first job at or after position from in
+			// the given index that is neither scheduled in s nor j
+			std::uint32_t first_pending(const By_time_map& index,
+			                            std::size_t from,
+			                            const State& s,
+			                            const Job<Time>& j) const
 			{
-				DM("      - looking for earliest possible job release starting from: "
-				   << s.earliest_job_release() << std::endl);
-				const Job<Time>* jp;
-				foreach_possibly_pending_job(s, jp) {
-					const Job<Time>& j = *jp;
-
-					DM("         * looking at " << j << std::endl);
-
-					// skip if it is the one we're ignoring
-					if (&j == &ignored_job)
-						continue;
-
-					DM("         * found it: " << j.earliest_arrival() << std::endl);
+				while (from < index.size()
+				       && (index[from].second == &j
+				           || !incomplete(s, *index[from].second)))
+					from++;
+				return from;
+			}
 
-					// it's incomplete and not ignored => found the earliest
-					return j.earliest_arrival();
-				}
+			// the pending jobs of the state that results from scheduling
+			// j in s
+			Pending_jobs pending_jobs_after(const State& s,
+			                                const Job<Time>& j) const
+			{
+				Pending_jobs p;
+				p.by_earliest_arrival = first_pending(
+					jobs_by_earliest_arrival,
+					s.pending_jobs().by_earliest_arrival, s, j);
+				p.by_latest_arrival = first_pending(
+					jobs_by_latest_arrival,
+					s.pending_jobs().by_latest_arrival, s, j);
+				p.earliest_release =
+					p.by_earliest_arrival < jobs_by_earliest_arrival.size() ?
+					jobs_by_earliest_arrival[p.by_earliest_arrival].first :
+					Time_model::constants<Time>::infinity();
+				DM("      - earliest possible job release after " << j
+				   << ": " << p.earliest_release << std::endl);
+				return p;
+			}
 
-				DM("         * No more future releases" << std::endl);
+			// the first jobs in jobs_by_earliest_arrival and in
+			// jobs_by_latest_arrival that are not yet scheduled in s
+			Job_iterator first_pending_by_earliest_arrival(const State& s) const
+			{
+				return jobs_by_earliest_arrival.begin()
+				       + s.pending_jobs().by_earliest_arrival;
+			}
 
-				return Time_model::constants<Time>::infinity();
+			Job_iterator first_pending_by_latest_arrival(const State& s) const
+			{
+				return jobs_by_latest_arrival.begin()
+				       + s.pending_jobs().by_latest_arrival;
 			}
 
 			bool iip_eligible(const State &s, const Job<Time> &j, Time t)
@@ -567,17 +659,63 @@ namespace NP {
 				return *s_ref;
 			}
 
+			// the unique set of scheduled jobs that results from
+			// scheduling j in s (with lookup key k)
+			const Job_set& scheduled_jobs_after(
+				const State& s, const Job<Time>& j, hash_value_t k)
+			{
+				// s is at the current depth, so the new set is one deeper
+				return job_sets_at(current_job_count + 1)
+				       .intern(s.get_scheduled_jobs(), index_of(j), k);
+			}
+
+			Job_set_pool& job_sets_at(unsigned long depth)
+			{
+				assert(depth >= first_pool_depth);
+				while (first_pool_depth + job_set_pools.size() <= depth) {
+					arenas.emplace_back();
+					job_set_pools.emplace_back(
+						use_arenas ? &arenas.back() : nullptr);
+				}
+				return job_set_pools[depth - first_pool_depth];
+			}
+
+			// drop the job sets of all depths before the current one
+			void release_job_sets()
+			{
+				track_arena_memory();
+				while (first_pool_depth < current_job_count
+				       && !job_set_pools.empty()) {
+					job_set_pools.pop_front();
+					arenas.pop_front();
+					first_pool_depth++;
+				}
+			}
+
 			bool not_done()
 			{
 				// if the curent queue is empty, move on to the next
 				if (todo[todo_idx].empty()) {
 					current_job_count++;
 					todo_idx = current_job_count % num_todo_queues;
+#ifndef CONFIG_COLLECT_SCHEDULE_GRAPH
+					// All states of the previous depth are gone, so we
+					// don't need their job sets anymore, either.
+					release_job_sets();
+#endif
 					return !todo[todo_idx].empty();
 				} else
 					return true;
 			}
 
+			void track_arena_memory()
+			{
+				std::size_t n = 0;
+				for (const Arena& a : arenas)
+					n += a.bytes_reserved();
+				arena_high_water = std::max(arena_high_water, n);
+			}
+
 			const State& next_state()
 			{
 				auto s = todo[todo_idx].front();
@@ -654,10 +792,17 @@ namespace NP {
 				return earliest_start + j.least_cost();
 			}
 
-			Time next_eligible_job_ready(const State& s) {
+			Time next_eligible_job_ready(const State& s)
+			{
+				return s.next_eligible_job_ready([&] () {
+					return find_next_eligible_job_ready(s);
+				});
+			}
+
+			Time find_next_eligible_job_ready(const State& s) {
 			    const Scheduled& already_scheduled = s.get_scheduled_jobs();
 
-			    for (auto it = jobs_by_latest_arrival.begin(); it != jobs_by_latest_arrival.end(); it++) {
+			    for (auto it = first_pending_by_latest_arrival(s); it != jobs_by_latest_arrival.end(); it++) {
 			        const Job<Time>& j = *(it->second);
 
 			        // not relevant if already scheduled
@@ -767,10 +912,11 @@ namespace NP {
 			// naive: no state merging
 			void schedule_job(const State &s, const Job<Time> &j)
 			{
+				auto k = s.next_key(job_key(j));
 				const State& next =
-					new_state(s, j, index_of(j),
+					new_state(s, job_key(j), scheduled_jobs_after(s, j, k),
 					          next_finish_times(s, j),
-					          earliest_possible_job_release(s, j));
+					          pending_jobs_after(s, j));
 				DM("      -----> S" << (states.end() - states.begin())
 				   << std::endl);
 				process_new_edge(s, next, j, next.finish_range());
@@ -840,19 +986,22 @@ namespace NP {
 			{
 				Interval<Time> finish_range = next_finish_times(s, j);
 
-				auto k = s.next_key(j);
+				auto k = s.next_key(job_key(j));
+
+				const Job_set& sched_jobs = scheduled_jobs_after(s, j, k);
 
 				auto r = states_by_key.equal_range(k);
 
 				if (r.first != r.second) {
-					Job_set sched_jobs{s.get_scheduled_jobs(), index_of(j)};
-
 					for (auto it = r.first; it != r.second; it++) {
 						State &found = *it->second;
 
 						// key collision if the job sets don't match exactly
-						if (found.get_scheduled_jobs() != sched_jobs)
+						// (interned sets are equal iff they are identical)
+						if (&found.get_scheduled_jobs() != &sched_jobs) {
+							num_key_collisions++;
 							continue;
+						}
 
 						// cannot merge without loss of accuracy if the
 						// intervals do not overlap
@@ -869,14 +1018,61 @@ namespace NP {
 				// If we reach here, we didn't find a match and need to create
 				// a new state.
 				const State& next =
-					new_state(s, j, index_of(j),
+					new_state(s, job_key(j), sched_jobs,
 					          finish_range,
-					          earliest_possible_job_release(s, j));
+					          pending_jobs_after(s, j));
 				DM("      -----> S" << (states.end() - states.begin())
 				   << std::endl);
 				process_new_edge(s, next, j, finish_range);
 			}
 
+			// Calls dispatch(j) for each job j that can be scheduled next in
+			// state s. Returns false if there is no such job.
+			template <typename Dispatch>
+			bool foreach_eligible_successor(const State& s, Dispatch dispatch)
+			{
+				// Identify relevant interval for next job
+				// relevant job buckets
+				auto ts_min = s.earliest_finish_time();
+				auto rel_min = s.earliest_job_release();
+				auto t_l = std::max(next_eligible_job_ready(s), s.latest_finish_time());
+
+				Interval<Time> next_range{std::min(ts_min, rel_min), t_l};
+
+				DM("ts_min = " << ts_min << std::endl <<
+				   "rel_min = " << rel_min << std::endl <<
+				   "latest_finish = " << s.latest_finish_time() << std::endl);
+				DM("=> next range = " << next_range << std::endl);
+
+				bool found_at_least_one = false;
+
+				DM("\n---\nChecking for pending and later-released jobs:"
+				   << std::endl);
+				const Job<Time>* jp;
+				foreach_possbly_pending_job_until(s, jp, next_range.upto()) {
+					const Job<Time>& j = *jp;
+					DM("+ " << j << std::endl);
+					// if it can be scheduled next...
+					if (is_eligible_successor(s, j)) {
+						DM("  --> can be next "  << std::endl);
+						dispatch(j);
+						found_at_least_one = true;
+					}
+				}
+
+				DM("---\nDone iterating over all jobs." << std::endl);
+
+				return found_at_least_one;
+			}
+
+			// true if s is a dead end, i.e., it has no successors but
+			// not all jobs have been scheduled yet
+			bool is_dead_end(const State& s, bool found_successor) const
+			{
+				return !found_successor &&
+				       s.get_scheduled_jobs().size() != jobs.size();
+			}
+
 			void explore()
 			{
 				make_initial_state();
@@ -890,41 +1086,12 @@ namespace NP {
 					   << (todo[todo_idx].front() - states.begin() + 1)
 					   << " " << s << std::endl);
 
-					// Identify relevant interval for next job
-					// relevant job buckets
-					auto ts_min = s.earliest_finish_time();
-					auto rel_min = s.earliest_job_release();
-					auto t_l = std::max(next_eligible_job_ready(s), s.latest_finish_time());
-
-					Interval<Time> next_range{std::min(ts_min, rel_min), t_l};
-
-					DM("ts_min = " << ts_min << std::endl <<
-					   "rel_min = " << rel_min << std::endl <<
-					   "latest_finish = " << s.latest_finish_time() << std::endl);
-					DM("=> next range = " << next_range << std::endl);
-
-					bool found_at_least_one = false;
-
-					DM("\n---\nChecking for pending and later-released jobs:"
-					   << std::endl);
-					const Job<Time>* jp;
-					foreach_possbly_pending_job_until(s, jp, next_range.upto()) {
-						const Job<Time>& j = *jp;
-						DM("+ " << j << std::endl);
-						// if it can be scheduled next...
-						if (is_eligible_successor(s, j)) {
-							DM("  --> can be next "  << std::endl);
-							// create the relevant state and continue
-							schedule(s, j);
-							found_at_least_one = true;
-						}
-					}
-
-					DM("---\nDone iterating over all jobs." << std::endl);
+					// create the relevant states and continue
+					bool found_at_least_one = foreach_eligible_successor(s,
+						[&] (const Job<Time>& j) { schedule(s, j); });
 
 					// check for a dead end
-					if (!found_at_least_one &&
-					    s.get_scheduled_jobs().size() != jobs.size()) {
+					if (is_dead_end(s, found_at_least_one)) {
 						// out of options and we didn't schedule all jobs
 						observed_deadline_miss = true;
 						if (early_exit)
@@ -938,6 +1105,236 @@ namespace NP {
 				}
 			}
 
+#ifdef CONFIG_PARALLEL
+
+			// a transition found in the first phase of explore_in_parallel()
+			struct Successor {
+				const Job<Time>* job;
+				Interval<Time> finish_range;
+				hash_value_t key;
+				const Job_set* scheduled;
+			};
+
+			typedef std::unordered_multimap<hash_value_t, State*> Shard_map;
+			typedef Finish_time_updates<Time> Partial_response_times;
+
+			// Parallel breadth-first variant of explore(). For each depth,
+			// (1) the successors of all states in the exploration front are
+			// determined in parallel, and then (2) the new states are merged
+			// in parallel over disjoint shards of the key space. Since
+			// states can be merged only if their keys match, each shard can
+			// replay its part of the transitions in exactly the order in
+			// which explore() processes them, which yields exactly the same
+			// states, edges, and response-time bounds.
+			void explore_in_parallel()
+			{
+				const std::size_t num_shards =
+					tbb::this_task_arena::max_concurrency();
+
+				auto shard_of = [num_shards] (hash_value_t key) {
+					return (std::size_t) (key % num_shards);
+				};
+
+				// the state cache, split by key
+				std::vector<Shard_map> cache(num_shards);
+				// per-shard statistics and response times
+				std::vector<unsigned long> shard_edges(num_shards, 0);
+				std::vector<unsigned long> shard_collisions(num_shards, 0);
+				std::vector<Partial_response_times> shard_rta(num_shards);
+
+				// the states of the current and the next depth, with one
+				// deque per shard
+				std::deque<std::vector<States>> depth_states;
+
+				// the initial state
+				depth_states.emplace_back(num_shards);
+				States& initial_shard = depth_states.back()[shard_of(0)];
+				initial_shard.emplace_back();
+				State* initial = &initial_shard.back();
+				assert(initial->get_key() == 0);
+				cache[shard_of(0)].insert(std::make_pair(initial->get_key(),
+				                                         initial));
+				num_states++;
+
+				// the exploration front, in the order of explore()
+				std::vector<State*> front{initial};
+
+				std::vector<std::vector<Successor>> successors;
+				std::vector<char> dead_end, deadline_miss;
+				std::vector<std::size_t> first_edge;
+				std::vector<State*> created;
+
+				while (!front.empty() && !aborted) {
+					auto n = front.size();
+
+					successors.resize(n);
+					dead_end.assign(n, 0);
+					deadline_miss.assign(n, 0);
+
+					// make sure the pool exists before we use it concurrently
+					job_sets_at(current_job_count + 1);
+
+					// (1) find all successors
+					tbb::parallel_for(tbb::blocked_range<std::size_t>(0, n),
+						[&] (const tbb::blocked_range<std::size_t>& r) {
+							for (auto i = r.begin(); i != r.end(); i++) {
+								const State& s = *front[i];
+								std::vector<Successor>& succ = successors[i];
+								succ.clear();
+								bool found = foreach_eligible_successor(s,
+									[&] (const Job<Time>& j) {
+										auto k = s.next_key(job_key(j));
+										auto ftimes = next_finish_times(s, j);
+										if (j.exceeds_deadline(ftimes.upto()))
+											deadline_miss[i] = 1;
+										succ.push_back({&j, ftimes, k,
+											&scheduled_jobs_after(s, j, k)});
+									});
+								dead_end[i] = is_dead_end(s, found);
+							}
+						});
+
+					// explore() stops after the first state that reveals a
+					// deadline miss if we exit early
+					std::size_t last = n;
+					for (std::size_t i = 0; i < n; i++)
+						if (dead_end[i] || deadline_miss[i]) {
+							observed_deadline_miss = true;
+							if (early_exit) {
+								aborted = true;
+								last = i + 1;
+								break;
+							}
+						}
+
+					first_edge.resize(last + 1);
+					first_edge[0] = 0;
+					for (std::size_t i = 0; i < last; i++)
+						first_edge[i + 1] = first_edge[i] + successors[i].size();
+					created.assign(first_edge[last], nullptr);
+
+					depth_states.emplace_back(num_shards);
+					std::vector<States>& new_states = depth_states.back();
+
+					// (2) merge or create the new states
+					tbb::parallel_for(
+						tbb::blocked_range<std::size_t>(0, num_shards, 1),
+						[&] (const tbb::blocked_range<std::size_t>& r) {
+							for (auto shard = r.begin(); shard != r.end(); shard++)
+								for (std::size_t i = 0; i < last; i++)
+									replay_transitions(*front[i], successors[i],
+										shard, shard_of,
+										cache[shard], new_states[shard],
+										created.data() + first_edge[i],
+										shard_edges[shard],
+										shard_collisions[shard],
+										shard_rta[shard]);
+						});
+
+					// propagate statistics and response times
+					for (std::size_t shard = 0; shard < num_shards; shard++) {
+						num_edges += shard_edges[shard];
+						num_key_collisions += shard_collisions[shard];
+						shard_edges[shard] = shard_collisions[shard] = 0;
+						for (const auto& r : shard_rta[shard])
+							update_finish_times(jobs[r.first], r.second);
+						shard_rta[shard].clear();
+					}
+
+					// the new front, in the order in which explore()
+					// would have created the states
+					front.clear();
+					for (State* s : created)
+						if (s)
+							front.push_back(s);
+					num_states += front.size();
+					if (!front.empty())
+						width = std::max(width, (unsigned long) front.size() - 1);
+
+					// all states of the old front have been explored
+					depth_states.pop_front();
+
+					if (max_depth && current_job_count == max_depth)
+						aborted = true;
+
+					current_job_count++;
+					release_job_sets();
+					check_cpu_timeout();
+				}
+			}
+
+			// the part of explore() for state s that concerns the given shard
+			template<typename Shard_of>
+			void replay_transitions(
+				const State& s,
+				const std::vector<Successor>& successors,
+				std::size_t shard,
+				Shard_of shard_of,
+				Shard_map& cache,
+				States& new_states,
+				State** created,
+				unsigned long& edges,
+				unsigned long& collisions,
+				Partial_response_times& partial_rta)
+			{
+				for (const Successor& succ : successors) {
+					if (shard_of(succ.key) != shard) {
+						created++;
+						continue;
+					}
+
+					bool merged = false;
+					auto r = cache.equal_range(succ.key);
+					for (auto it = r.first; it != r.second; it++) {
+						State &found = *it->second;
+
+						// key collision if the job sets don't match exactly
+						if (&found.get_scheduled_jobs() != succ.scheduled) {
+							collisions++;
+							continue;
+						}
+
+						// cannot merge without loss of accuracy if the
+						// intervals do not overlap
+						if (!succ.finish_range.intersects(found.finish_range()))
+							continue;
+
+						// great, we found a match and can merge the states
+						found.update_finish_range(succ.finish_range);
+						merged = true;
+						break;
+					}
+
+					if (!merged) {
+						const Job<Time>& j = *succ.job;
+						new_states.emplace_back(s, job_key(j), *succ.scheduled,
+						                        succ.finish_range,
+						                        pending_jobs_after(s, j));
+						State* next = &new_states.back();
+						cache.insert(std::make_pair(succ.key, next));
+						*created = next;
+					}
+					created++;
+
+					// update response times and statistics
+					partial_rta.emplace_back(index_of(*succ.job),
+					                         succ.finish_range);
+					edges++;
+				}
+
+				// s is done, remove it from the cache
+				if (shard_of(s.get_key()) == shard) {
+					auto matches = cache.equal_range(s.get_key());
+					for (auto it = matches.first; it != matches.second; it++)
+						if (it->second == &s) {
+							cache.erase(it);
+							break;
+						}
+				}
+			}
+
+#endif
+
 #ifdef CONFIG_COLLECT_SCHEDULE_GRAPH
 			friend std::ostream& operator<< (std::ostream& out,
 			                                 const State_space<Time, IIP>& space)
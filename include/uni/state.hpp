@@ -2,10 +2,13 @@
 #include <ostream>
 #include <cassert>
 #include <algorithm>
+#include <cstdint>
+#include <limits>
 
 #include <set>
 
 #include "index_set.hpp"
+#include "index_set_pool.hpp"
 #include "jobs.hpp"
 #include "cache.hpp"
 
@@ -15,16 +18,36 @@ namespace NP {
 
 	namespace Uniproc {
 
-		typedef Index_set Job_set;
+		typedef Job_index_set Job_set;
+
+		// Where the jobs that are not yet scheduled in a state start in
+		// the state space's indices by earliest and latest arrival time
+		// (i.e., all jobs before these positions are scheduled), so that
+		// scans of these indices can skip the jobs that are done.
+		template<class Time> struct Pending_jobs
+		{
+			// earliest arrival of any job not yet scheduled
+			Time earliest_release;
+			std::uint32_t by_earliest_arrival;
+			std::uint32_t by_latest_arrival;
+		};
 
 		template<class Time> class Schedule_state
 		{
 			private:
 
 			Interval<Time> finish_time;
-			Time earliest_pending_release;
+			Pending_jobs<Time> pending;
 
-			Job_set scheduled_jobs;
+			// shared with all other states that scheduled the same jobs
+			const Job_set* scheduled_jobs;
+
+			// The next times by which an eligible job is certainly ready
+			// and by which some job is certainly released. They depend
+			// only on this state, so the state space computes them once,
+			// when it first needs them while looking for successors.
+			mutable Time eligible_job_ready;
+			mutable Time certain_job_release;
 			hash_value_t lookup_key;
 
 			// no accidental copies
@@ -35,22 +58,29 @@ namespace NP {
 			// initial state
 			Schedule_state()
 			: finish_time{0, 0}
+			, pending{0, 0, 0}
+			, scheduled_jobs{&empty_index_set<Job_set>()}
+			, eligible_job_ready{not_memoized()}
+			, certain_job_release{not_memoized()}
 			, lookup_key{0}
-			, earliest_pending_release{0}
 			{
 			}
 
 			// transition: new state by scheduling a job in an existing state
+			//             (the caller interns the resulting set of
+			//             scheduled jobs)
 			Schedule_state(
 				const Schedule_state& from,
-				const Job<Time>& j,
-				std::size_t idx,
+				hash_value_t job_key,
+				const Job_set& scheduled,
 				Interval<Time> ftimes,
-				const Time next_earliest_release)
+				const Pending_jobs<Time>& next_pending)
 			: finish_time{ftimes}
-			, scheduled_jobs{from.scheduled_jobs, idx}
-			, lookup_key{from.next_key(j)}
-			, earliest_pending_release{next_earliest_release}
+			, pending{next_pending}
+			, scheduled_jobs{&scheduled}
+			, eligible_job_ready{not_memoized()}
+			, certain_job_release{not_memoized()}
+			, lookup_key{from.next_key(job_key)}
 			{
 			}
 
@@ -66,7 +96,12 @@ namespace NP {
 
 			Time earliest_job_release() const
 			{
-				return earliest_pending_release;
+				return pending.earliest_release;
+			}
+
+			const Pending_jobs<Time>& pending_jobs() const
+			{
+				return pending;
 			}
 
 			const Interval<Time>& finish_range() const
@@ -78,6 +113,29 @@ namespace NP {
 			{
 				assert(update.intersects(finish_time));
 				finish_time.widen(update);
+				// the memoized times depend on the finish range
+				eligible_job_ready = not_memoized();
+				certain_job_release = not_memoized();
+			}
+
+			// returns the memoized next eligible job ready time,
+			// obtaining it from compute() on first use
+			template<typename Compute>
+			Time next_eligible_job_ready(Compute compute) const
+			{
+				if (eligible_job_ready == not_memoized())
+					eligible_job_ready = compute();
+				return eligible_job_ready;
+			}
+
+			// returns the memoized next certain job release time,
+			// obtaining it from compute() on first use
+			template<typename Compute>
+			Time next_certain_job_release(Compute compute) const
+			{
+				if (certain_job_release == not_memoized())
+					certain_job_release = compute();
+				return certain_job_release;
 			}
 
 			hash_value_t get_key() const
@@ -87,20 +145,34 @@ namespace NP {
 
 			const Job_set& get_scheduled_jobs() const
 			{
-				return scheduled_jobs;
+				return *scheduled_jobs;
 			}
 
+			// NOTE: assumes that both states obtained their job sets
+			//       from the same pool
 			bool matches(const Schedule_state& other) const
 			{
 				return lookup_key == other.lookup_key &&
 					   scheduled_jobs == other.scheduled_jobs;
 			}
 
-			hash_value_t next_key(const Job<Time>& j) const
+			// key of the state that results from scheduling a job with
+			// the given (Zobrist) key
+			hash_value_t next_key(hash_value_t job_key) const
+			{
+				return get_key() ^ job_key;
+			}
+
+			private:
+
+			// both times are job arrival times or infinity
+			static Time not_memoized()
 			{
-				return get_key() ^ j.get_key();
+				return std::numeric_limits<Time>::lowest();
 			}
 
+			public:
+
 			friend std::ostream& operator<< (std::ostream& stream,
 			                                 const Schedule_state<Time>& s)
 			{
@@ -0,0 +1,52 @@
+#ifndef ZOBRIST_HPP
+#define ZOBRIST_HPP
+
+#include <vector>
+#include <cstdint>
+
+#include "jobs.hpp"
+
+namespace NP {
+
+	// Zobrist hashing of sets of job indices: every job index is assigned
+	// a pseudo-random 64-bit key, and the key of a set of jobs is the XOR
+	// of the keys of its members. Unlike Job::get_key(), which is derived
+	// from the job parameters (and hence collides frequently for periodic
+	// workloads with regular parameters), these keys are statistically
+	// independent, so distinct sets of scheduled jobs essentially never
+	// share a key.
+	class Zobrist_keys
+	{
+		public:
+
+		static const std::uint64_t default_seed = 0x5eed5eed12345678ULL;
+
+		Zobrist_keys(std::size_t num_jobs, std::uint64_t seed = default_seed)
+		: keys(num_jobs)
+		{
+			std::uint64_t state = seed;
+			for (auto& k : keys)
+				k = splitmix64(state);
+		}
+
+		hash_value_t operator[](std::size_t idx) const
+		{
+			return keys[idx];
+		}
+
+		private:
+
+		std::vector<hash_value_t> keys;
+
+		// see http://xoshiro.di.unimi.it/splitmix64.c
+		static std::uint64_t splitmix64(std::uint64_t& state)
+		{
+			std::uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+			z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+			z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+			return z ^ (z >> 31);
+		}
+	};
+}
+
+#endif
@@ -2,9 +2,25 @@
 #include <sstream>
 #include <fstream>
 #include <algorithm>
+#include <cerrno>
+#include <system_error>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
 
 #ifndef _WIN32
 #include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <csignal>
+#include <cstdio>
+#include <unistd.h>
 #endif
 
 #include "OptionParser.h"
@@ -13,7 +29,15 @@
 
 #ifdef CONFIG_PARALLEL
 
-#include "tbb/task_scheduler_init.h"
+#include "tbb/global_control.h"
+#include "tbb/task_arena.h"
+#include "tbb/parallel_pipeline.h"
+
+#else
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
 #endif
 
@@ -21,6 +45,7 @@
 #include "uni/space.hpp"
 #include "global/space.hpp"
 #include "io.hpp"
+#include "json.hpp"
 #include "clock.hpp"
 
 
@@ -34,6 +59,7 @@ static bool want_cw_iip;
 
 static bool want_precedence = false;
 static std::string precedence_file;
+static bool want_reduced_precedence = false;
 
 static bool want_aborts = false;
 static std::string aborts_file;
@@ -49,10 +75,21 @@ static unsigned int max_depth = 0;
 
 static bool want_rta_file;
 
+static bool want_stats = false;
+
+static bool want_arenas = true;
+
 static bool continue_after_dl_miss = false;
 
+static bool want_convert = false;
+static std::string convert_file;
+
+static unsigned int num_jobs = 1;
+
 #ifdef CONFIG_PARALLEL
 static unsigned int num_worker_threads = 0;
+static bool want_parallel_uniproc = false;
+static bool want_deterministic = false;
 #endif
 
 struct Analysis_result {
@@ -60,27 +97,53 @@ struct Analysis_result {
 	bool timeout;
 	unsigned long number_of_states, number_of_edges, max_width, number_of_jobs;
 	double cpu_time;
+	unsigned long key_collisions;
+	std::size_t arena_memory;
+	long setup_memory;
+	Lookup_table_occupancy lookup_table;
+	NP::Precedence_summary precedence;
+	NP::Input_statistics input;
 	std::string graph;
 	std::string response_times_csv;
 };
 
-template<class Time, class Space>
-static Analysis_result analyze(
-	std::istream &in,
-	std::istream &dag_in,
-	std::istream &aborts_in)
+// peak memory usage so far, as reported by getrusage()
+static long peak_memory_usage()
 {
-#ifdef CONFIG_PARALLEL
-	tbb::task_scheduler_init init(
-		num_worker_threads ? num_worker_threads : tbb::task_scheduler_init::automatic);
+#ifdef _WIN32 // rusage does not work under Windows
+	return 0;
+#else
+	struct rusage u;
+	if (getrusage(RUSAGE_SELF, &u) == 0)
+		return u.ru_maxrss;
+	else
+		return 0;
 #endif
+}
 
+template<class Time, class Space>
+static Analysis_result analyze(
+	const NP::Input_file &in,
+	const NP::Input_file &dag_in,
+	const NP::Input_file &aborts_in)
+{
 	// Parse input files and create NP scheduling problem description
+	auto workload = NP::load_workload<Time>(in, dag_in, aborts_in);
 	NP::Scheduling_problem<Time> problem{
-		NP::parse_file<Time>(in),
-		NP::parse_dag_file(dag_in),
-		NP::parse_abort_file<Time>(aborts_in),
+		std::move(workload.jobs),
+		std::move(workload.dag),
+		std::move(workload.aborts),
 		num_processors};
+	if (want_reduced_precedence)
+		problem.drop_redundant_precedence();
+
+	auto input = in.statistics();
+	input += dag_in.statistics();
+	input += aborts_in.statistics();
+
+	// the inputs were parsed once and moved into the problem
+	// description, so this is the peak of the parse/setup phase
+	long setup_memory = peak_memory_usage();
 
 	// Set common analysis options
 	NP::Analysis_options opts;
@@ -89,6 +152,13 @@ static Analysis_result analyze(
 	opts.early_exit = !continue_after_dl_miss;
 	opts.num_buckets = problem.jobs.size();
 	opts.be_naive = want_naive;
+	opts.use_arenas = want_arenas;
+	// the CPU time of the process is shared by all files analyzed at once
+	opts.use_wall_clock = num_jobs > 1;
+#ifdef CONFIG_PARALLEL
+	opts.parallel = want_parallel_uniproc;
+	opts.deterministic = want_deterministic;
+#endif
 
 	// Actually call the analysis engine
 	auto space = Space::explore(problem, opts);
@@ -126,15 +196,21 @@ static Analysis_result analyze(
 		space.max_exploration_front_width(),
 		problem.jobs.size(),
 		space.get_cpu_time(),
+		space.number_of_key_collisions(),
+		space.arena_memory_high_water(),
+		setup_memory,
+		space.lookup_table_occupancy(),
+		problem.precedence,
+		input,
 		graph.str(),
 		rta.str()
 	};
 }
 
 static Analysis_result process_stream(
-	std::istream &in,
-	std::istream &dag_in,
-	std::istream &aborts_in)
+	const NP::Input_file &in,
+	const NP::Input_file &dag_in,
+	const NP::Input_file &aborts_in)
 {
 	if (want_multiprocessor && want_dense)
 		return analyze<dense_t, NP::Global::State_space<dense_t>>(in, dag_in, aborts_in);
@@ -154,39 +230,131 @@ static Analysis_result process_stream(
 		return analyze<dtime_t, NP::Uniproc::State_space<dtime_t>>(in, dag_in, aborts_in);
 }
 
-static void process_file(const std::string& fname)
+// where the extension of a job set file name starts that the names of
+// the output files replace (or npos if it has none of them)
+static std::string::size_type extension_of(const std::string& fname)
+{
+	auto p = fname.find(".csv");
+	if (p == std::string::npos)
+		p = fname.rfind(".bin");
+	return p;
+}
+
+// write the workload to convert_file as a binary job set file
+template<class Time>
+static void convert(
+	const NP::Input_file &in,
+	const NP::Input_file &dag_in,
+	const NP::Input_file &aborts_in)
+{
+	auto workload = NP::load_workload<Time>(in, dag_in, aborts_in);
+
+	// reject what the analysis would reject
+	NP::Job_id_map job_index(workload.jobs);
+	NP::validate_prec_refs(workload.dag, job_index);
+	NP::validate_abort_refs<Time>(workload.aborts, workload.jobs, job_index);
+
+	auto out = std::ofstream(convert_file, std::ios::out | std::ios::binary);
+	NP::write_binary_job_set(out, workload);
+	out.close();
+	if (!out)
+		throw std::system_error(errno, std::generic_category(), convert_file);
+}
+
+// what the analysis of a job set file prints
+struct File_report {
+	// the result row (or nothing, if the file could not be analyzed)
+	std::string output;
+	// warnings and error messages
+	std::string errors;
+	// nonzero if the file could not be analyzed
+	int exit_code;
+};
+
+// Calls f() and reports the errors that it may raise (e.g., about the
+// given job set file) to err, as nptest prints them. Returns the exit
+// code of nptest (zero if there was no error).
+template<typename F>
+static int reporting_errors(const std::string& fname, std::ostream& err, F f)
 {
 	try {
+		f();
+	} catch (NP::Parse_error& ex) {
+		err << ex.what() << std::endl;
+		return 1;
+	} catch (std::ios_base::failure& ex) {
+		err << fname;
+		if (want_precedence)
+			err << " + " << precedence_file;
+		err <<  ": parse error" << std::endl;
+		return 1;
+	} catch (NP::InvalidJobReference& ex) {
+		err << precedence_file << ": bad job reference: job "
+		    << ex.ref.job << " of task " << ex.ref.task
+		    << " is not part of the job set given in "
+		    << fname
+		    << std::endl;
+		return 3;
+	} catch (NP::InvalidAbortParameter& ex) {
+		err << aborts_file << ": invalid abort parameter: job "
+		    << ex.ref.job << " of task " << ex.ref.task
+		    << " has an impossible abort time (abort before release)"
+		    << std::endl;
+		return 4;
+	} catch (NP::Invalid_binary_job_set& ex) {
+		err << ex.what() << std::endl;
+		return 1;
+	} catch (std::exception& ex) {
+		err << fname << ": '" << ex.what() << "'" << std::endl;
+		return 1;
+	}
+	return 0;
+}
+
+static void warn_about_cycle(const NP::Precedence_summary& precedence,
+                             std::ostream& err)
+{
+	err << precedence_file << ": warning: cyclic precedence "
+	    << "constraints: ";
+	for (const auto& id : precedence.cycle)
+		err << id << " -> ";
+	err << precedence.cycle.front() << std::endl;
+}
+
+static File_report process_file(const std::string& fname)
+{
+	auto out = std::ostringstream();
+	auto err = std::ostringstream();
+
+	int exit_code = reporting_errors(fname, err, [&] () {
 		Analysis_result result;
 
-		auto empty_dag_stream = std::istringstream("\n");
-		auto empty_aborts_stream = std::istringstream("\n");
-		auto dag_stream = std::ifstream();
-		auto aborts_stream = std::ifstream();
+		// without precedence constraints or abort actions, the inputs
+		// are empty
+		NP::Input_file dag_in, aborts_in;
 
 		if (want_precedence)
-			dag_stream.open(precedence_file);
+			dag_in = NP::Input_file(precedence_file);
 
 		if (want_aborts)
-			aborts_stream.open(aborts_file);
-
-		std::istream &dag_in = want_precedence ?
-			static_cast<std::istream&>(dag_stream) :
-			static_cast<std::istream&>(empty_dag_stream);
+			aborts_in = NP::Input_file(aborts_file);
+
+		if (want_convert) {
+			if (want_dense)
+				convert<dense_t>(NP::Input_file(fname), dag_in, aborts_in);
+			else
+				convert<dtime_t>(NP::Input_file(fname), dag_in, aborts_in);
+			return;
+		}
 
-		std::istream &aborts_in = want_aborts ?
-			static_cast<std::istream&>(aborts_stream) :
-			static_cast<std::istream&>(empty_aborts_stream);
+		// "-" is std::cin
+		result = process_stream(NP::Input_file(fname), dag_in, aborts_in);
 
-		if (fname == "-")
-			result = process_stream(std::cin, dag_in, aborts_in);
-		else {
-			auto in = std::ifstream(fname, std::ios::in);
-			result = process_stream(in, dag_in, aborts_in);
+		if (fname != "-") {
 #ifdef CONFIG_COLLECT_SCHEDULE_GRAPH
 			if (want_dot_graph) {
 				std::string dot_name = fname;
-				auto p = dot_name.find(".csv");
+				auto p = extension_of(dot_name);
 				if (p != std::string::npos) {
 					dot_name.replace(p, std::string::npos, ".dot");
 					auto out  = std::ofstream(dot_name,  std::ios::out);
@@ -197,7 +365,7 @@ static void process_file(const std::string& fname)
 #endif
 			if (want_rta_file) {
 				std::string rta_name = fname;
-				auto p = rta_name.find(".csv");
+				auto p = extension_of(rta_name);
 				if (p != std::string::npos) {
 					rta_name.replace(p, std::string::npos, ".rta.csv");
 					auto out  = std::ofstream(rta_name,  std::ios::out);
@@ -207,57 +375,559 @@ static void process_file(const std::string& fname)
 			}
 		}
 
-#ifdef _WIN32 // rusage does not work under Windows
-		long mem_used = 0;
-#else
-		struct rusage u;
-		long mem_used = 0;
-		if (getrusage(RUSAGE_SELF, &u) == 0)
-			mem_used = u.ru_maxrss;
-#endif
+		if (!result.precedence.is_acyclic())
+			warn_about_cycle(result.precedence, err);
+
+		long mem_used = peak_memory_usage();
 
-		std::cout << fname;
+		out << fname;
 
 		if (max_depth && max_depth < result.number_of_jobs)
 			// mark result as invalid due to debug abort
-			std::cout << ",  X";
+			out << ",  X";
 		else
-			std::cout << ",  " << (int) result.schedulable;
-
-		std::cout << ",  " << result.number_of_jobs
-		          << ",  " << result.number_of_states
-		          << ",  " << result.number_of_edges
-		          << ",  " << result.max_width
-		          << ",  " << std::fixed << result.cpu_time
-		          << ",  " << ((double) mem_used) / (1024.0)
-		          << ",  " << (int) result.timeout
-		          << ",  " << num_processors
-		          << std::endl;
-	} catch (std::ios_base::failure& ex) {
-		std::cerr << fname;
-		if (want_precedence)
-			std::cerr << " + " << precedence_file;
-		std::cerr <<  ": parse error" << std::endl;
-		exit(1);
-	} catch (NP::InvalidJobReference& ex) {
-		std::cerr << precedence_file << ": bad job reference: job "
-		          << ex.ref.job << " of task " << ex.ref.task
-			      << " is not part of the job set given in "
-			      << fname
-			      << std::endl;
-		exit(3);
-	} catch (NP::InvalidAbortParameter& ex) {
-		std::cerr << aborts_file << ": invalid abort parameter: job "
-		          << ex.ref.job << " of task " << ex.ref.task
-			      << " has an impossible abort time (abort before release)"
-			      << std::endl;
-		exit(4);
+			out << ",  " << (int) result.schedulable;
+
+		out << ",  " << result.number_of_jobs
+		    << ",  " << result.number_of_states
+		    << ",  " << result.number_of_edges
+		    << ",  " << result.max_width
+		    << ",  " << std::fixed << result.cpu_time
+		    << ",  " << ((double) mem_used) / (1024.0)
+		    << ",  " << (int) result.timeout
+		    << ",  " << num_processors;
+
+		if (want_stats)
+			out << ",  " << result.key_collisions
+			    << ",  " << ((double) result.arena_memory)
+			                / (1024.0 * 1024.0)
+			    << ",  " << ((double) result.setup_memory) / (1024.0)
+			    << ",  " << result.lookup_table.buckets
+			    << ",  " << result.lookup_table.mean()
+			    << ",  " << result.lookup_table.largest
+			    << ",  " << result.precedence.remaining_edges()
+			    << ",  " << result.precedence.redundant_edges
+			    << ",  " << result.input.decompression_speed()
+			    << ",  " << result.input.parse_speed();
+
+		out << std::endl;
+	});
+
+	// no result row for a file that could not be analyzed
+	return File_report{exit_code ? "" : out.str(), err.str(), exit_code};
+}
+
+static void print_report(const File_report& report)
+{
+	std::cerr << report.errors << std::flush;
+	std::cout << report.output << std::flush;
+}
+
+// Analyzes num_jobs of the files at a time and prints the results in the
+// order of the files. Stops at the first file that cannot be analyzed,
+// once the results of all files before it have been printed, and
+// returns its exit code (or zero if all files were analyzed).
+static int process_files(const std::vector<std::string>& files)
+{
+	std::atomic<int> exit_code(0);
+
+#ifdef CONFIG_PARALLEL
+	// The files pass through a pipeline that runs in the same task arena
+	// as the parallel loops of the analyses, so both draw on the same
+	// worker threads (as limited by --threads).
+	std::size_t next = 0;
+	tbb::parallel_pipeline(num_jobs,
+		tbb::make_filter<void, std::size_t>(
+			tbb::filter_mode::serial_in_order,
+			[&] (tbb::flow_control& fc) -> std::size_t {
+				if (next == files.size() || exit_code) {
+					fc.stop();
+					return 0;
+				}
+				return next++;
+			})
+		& tbb::make_filter<std::size_t, File_report>(
+			tbb::filter_mode::parallel,
+			[&] (std::size_t i) {
+				// keep threads that wait for a parallel loop of this
+				// analysis from picking up the analysis of another file
+				return tbb::this_task_arena::isolate([&] {
+					return process_file(files[i]);
+				});
+			})
+		& tbb::make_filter<File_report, void>(
+			tbb::filter_mode::serial_in_order,
+			[&] (const File_report& report) {
+				if (exit_code)
+					return;
+				print_report(report);
+				exit_code = report.exit_code;
+			}));
+#else
+	std::mutex mutex;
+	std::condition_variable finished;
+	std::vector<std::unique_ptr<File_report>> reports(files.size());
+	std::size_t next = 0;
+
+	auto work = [&] () {
+		while (true) {
+			std::size_t i;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				if (next == files.size() || exit_code)
+					return;
+				i = next++;
+			}
+			std::unique_ptr<File_report> report(
+				new File_report(process_file(files[i])));
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				reports[i] = std::move(report);
+			}
+			finished.notify_all();
+		}
+	};
+
+	std::vector<std::thread> workers;
+	for (unsigned int k = 0; k < num_jobs; k++)
+		workers.emplace_back(work);
+
+	for (std::size_t i = 0; i < files.size() && !exit_code; i++) {
+		std::unique_ptr<File_report> report;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			finished.wait(lock, [&] () { return reports[i] != nullptr; });
+			report = std::move(reports[i]);
+			exit_code = report->exit_code;
+		}
+		print_report(*report);
+	}
+
+	for (auto& w : workers)
+		w.join();
+#endif
+
+	return exit_code;
+}
+
+// The options that a request to the analysis server (--serve) can set.
+// They default to the ones given on the command line.
+struct Request_options {
+	bool dense, prm_iip, cw_iip, naive;
+	bool multiprocessor;
+	unsigned int processors;
+	double timeout;
+	unsigned int max_depth;
+	bool continue_after_dl_miss;
+	bool precedence, aborts;
+	std::string precedence_file, aborts_file;
+	bool reduce_precedence;
+	bool rta, stats;
+#ifdef CONFIG_PARALLEL
+	bool deterministic;
+#endif
+};
+
+static Request_options current_options()
+{
+	Request_options o;
+	o.dense = want_dense;
+	o.prm_iip = want_prm_iip;
+	o.cw_iip = want_cw_iip;
+	o.naive = want_naive;
+	o.multiprocessor = want_multiprocessor;
+	o.processors = num_processors;
+	o.timeout = timeout;
+	o.max_depth = max_depth;
+	o.continue_after_dl_miss = continue_after_dl_miss;
+	o.precedence = want_precedence;
+	o.precedence_file = precedence_file;
+	o.aborts = want_aborts;
+	o.aborts_file = aborts_file;
+	o.reduce_precedence = want_reduced_precedence;
+	o.rta = want_rta_file;
+	o.stats = want_stats;
+#ifdef CONFIG_PARALLEL
+	o.deterministic = want_deterministic;
+#endif
+	return o;
+}
+
+static void use_options(const Request_options& o)
+{
+	want_dense = o.dense;
+	want_prm_iip = o.prm_iip;
+	want_cw_iip = o.cw_iip;
+	want_naive = o.naive;
+	want_multiprocessor = o.multiprocessor;
+	num_processors = o.processors;
+	timeout = o.timeout;
+	max_depth = o.max_depth;
+	continue_after_dl_miss = o.continue_after_dl_miss;
+	want_precedence = o.precedence;
+	precedence_file = o.precedence_file;
+	want_aborts = o.aborts;
+	aborts_file = o.aborts_file;
+	want_reduced_precedence = o.reduce_precedence;
+	want_rta_file = o.rta;
+	want_stats = o.stats;
+#ifdef CONFIG_PARALLEL
+	want_deterministic = o.deterministic;
+#endif
+}
+
+// a request that cannot be carried out as given
+class Bad_request : public std::runtime_error
+{
+	public:
+
+	Bad_request(const std::string& problem)
+	: std::runtime_error(problem)
+	{
+	}
+};
+
+// Reads an input of a request, which is given either as the path of a
+// file (in the field called name) or inline (in name + "_csv").
+// Returns false if the request has neither.
+static bool request_input(const NP::JSON::Object& request,
+                          const std::string& name,
+                          NP::Input_file& in, std::string& in_name)
+{
+	auto path = request.find(name);
+	auto text = request.find(name + "_csv");
+	if (path != request.end() && text != request.end())
+		throw Bad_request("both '" + name + "' and '" + name
+		                  + "_csv' given");
+
+	if (path != request.end()) {
+		if (path->second.type() != NP::JSON::Value::string
+		    || path->second.as_string().empty())
+			throw Bad_request("'" + name + "' must be a file name");
+		// the server's standard input carries the requests
+		if (path->second.as_string() == "-")
+			throw Bad_request("'" + name + "' cannot be read from "
+			                  "standard input");
+		in_name = path->second.as_string();
+		in = NP::Input_file(in_name);
+		return true;
+	}
+
+	if (text != request.end()) {
+		if (text->second.type() != NP::JSON::Value::string)
+			throw Bad_request("'" + name + "_csv' must be a string");
+		auto csv = std::istringstream(text->second.as_string());
+		in_name = name + "_csv";
+		in = NP::Input_file(csv, in_name);
+		return true;
+	}
+
+	return false;
+}
+
+// Applies the options given in the request (see README) on top of the
+// defaults.
+static void use_request_options(const NP::JSON::Object& request,
+                                const Request_options& defaults)
+{
+	static const char* known_fields[] = {
+		"id", "jobs", "jobs_csv", "precedence", "precedence_csv",
+		"aborts", "aborts_csv", "time", "processors", "iip", "naive",
+		"time_limit", "depth_limit", "continue_after_deadline_miss",
+		"deterministic", "reduce_precedence", "response_times", "stats"
+	};
+	for (const auto& f : request)
+		if (std::find_if(std::begin(known_fields), std::end(known_fields),
+		                 [&] (const char* k) { return f.first == k; })
+		    == std::end(known_fields))
+			throw Bad_request("unknown field '" + f.first + "'");
+
+	auto field = [&] (const char* name, NP::JSON::Value::Kind kind,
+	                  const char* what) -> const NP::JSON::Value* {
+		auto f = request.find(name);
+		if (f == request.end())
+			return nullptr;
+		if (f->second.type() != kind)
+			throw Bad_request(std::string("'") + name + "' must be " + what);
+		return &f->second;
+	};
+	auto flag = [&] (const char* name, bool& option) {
+		if (auto v = field(name, NP::JSON::Value::boolean, "true or false"))
+			option = v->as_bool();
+	};
+	// a whole number in [min, max]
+	auto count = [&] (const char* name, double min, double max) {
+		auto v = field(name, NP::JSON::Value::number, "a number");
+		auto x = v->as_number();
+		if (!(x >= min && x <= max) || x != std::floor(x))
+			throw Bad_request(std::string("invalid '") + name + "'");
+		return (unsigned int) x;
+	};
+
+	use_options(defaults);
+
+	if (auto v = field("time", NP::JSON::Value::string,
+	                   "\"dense\" or \"discrete\"")) {
+		if (v->as_string() != "dense" && v->as_string() != "discrete")
+			throw Bad_request("'time' must be \"dense\" or \"discrete\"");
+		want_dense = v->as_string() == "dense";
+	}
+
+	if (request.count("processors")) {
+		want_multiprocessor = true;
+		num_processors = count("processors", 1, MAX_PROCESSORS);
+	}
+
+	if (auto v = field("iip", NP::JSON::Value::string,
+	                   "\"none\", \"P-RM\", or \"CW\"")) {
+		const std::string& iip = v->as_string();
+		if (iip != "none" && iip != "P-RM" && iip != "CW")
+			throw Bad_request("'iip' must be \"none\", \"P-RM\", or \"CW\"");
+		want_prm_iip = iip == "P-RM";
+		want_cw_iip = iip == "CW";
+	}
+
+	flag("naive", want_naive);
+
+	if (auto v = field("time_limit", NP::JSON::Value::number, "a number")) {
+		if (!(v->as_number() >= 0))
+			throw Bad_request("invalid 'time_limit'");
+		timeout = v->as_number();
+	}
+
+	if (request.count("depth_limit"))
+		max_depth = count("depth_limit", 2, UINT_MAX) - 1;
+
+	flag("continue_after_deadline_miss", continue_after_dl_miss);
+#ifdef CONFIG_PARALLEL
+	flag("deterministic", want_deterministic);
+#else
+	bool deterministic;
+	flag("deterministic", deterministic);
+#endif
+	flag("reduce_precedence", want_reduced_precedence);
+	flag("response_times", want_rta_file);
+	flag("stats", want_stats);
+}
+
+// Answers a request to the analysis server (a JSON object on the given
+// line of the requests) with a JSON object (see README).
+static void answer(std::ostream& out, const std::string& request,
+                   std::size_t line, const Request_options& defaults)
+{
+	NP::JSON::Writer response(out);
+
+	NP::JSON::Object req;
+	NP::Input_file jobs_in, dag_in, aborts_in;
+	std::string fname;
+
+	// first check the request itself...
+	try {
+		req = NP::JSON::parse_object(request, "request", line);
+		if (req.count("id"))
+			response.field("id", req["id"]);
+
+		use_request_options(req, defaults);
+
+		if (!request_input(req, "jobs", jobs_in, fname))
+			throw Bad_request("no job set given ('jobs' or 'jobs_csv')");
+		if (request_input(req, "precedence", dag_in, precedence_file))
+			want_precedence = true;
+		else if (want_precedence)
+			dag_in = NP::Input_file(precedence_file);
+		if (request_input(req, "aborts", aborts_in, aborts_file))
+			want_aborts = true;
+		else if (want_aborts)
+			aborts_in = NP::Input_file(aborts_file);
 	} catch (std::exception& ex) {
-		std::cerr << fname << ": '" << ex.what() << "'" << std::endl;
-		exit(1);
+		response.field("error", ex.what());
+		response.field("exit_code", 1);
+		return;
+	}
+
+	// ... then the job set, as nptest would
+	auto err = std::ostringstream();
+	Analysis_result result;
+	int exit_code = reporting_errors(fname, err, [&] () {
+		result = process_stream(jobs_in, dag_in, aborts_in);
+	});
+
+	// the message without its line break
+	auto message = err.str();
+	if (!message.empty())
+		message.pop_back();
+
+	if (exit_code) {
+		response.field("error", message);
+		response.field("exit_code", exit_code);
+		return;
+	}
+
+	response.field("file", fname);
+	if (max_depth && max_depth < result.number_of_jobs)
+		// invalid due to debug abort
+		response.field("schedulable", NP::JSON::Value());
+	else
+		response.field("schedulable", result.schedulable);
+	// The peak memory usage (columns 8 and 13 of the CSV output) is that
+	// of the whole server process so far, which says nothing about the
+	// request at hand, so it is left out.
+	response.field("jobs", result.number_of_jobs)
+	        .field("states", result.number_of_states)
+	        .field("edges", result.number_of_edges)
+	        .field("max_width", result.max_width)
+	        .field("cpu_time", result.cpu_time)
+	        .field("timeout", result.timeout)
+	        .field("processors", num_processors);
+
+	if (want_stats)
+		response.field("key_collisions", result.key_collisions)
+		        .field("arena_memory", ((double) result.arena_memory)
+		                               / (1024.0 * 1024.0))
+		        .field("buckets", result.lookup_table.buckets)
+		        .field("mean_bucket_size", result.lookup_table.mean())
+		        .field("max_bucket_size", result.lookup_table.largest)
+		        .field("precedence_constraints",
+		               result.precedence.remaining_edges())
+		        .field("redundant_constraints",
+		               result.precedence.redundant_edges)
+		        .field("decompression_speed",
+		               result.input.decompression_speed())
+		        .field("parse_speed", result.input.parse_speed());
+
+	if (want_rta_file)
+		response.field("response_times", result.response_times_csv);
+
+	if (!result.precedence.is_acyclic()) {
+		warn_about_cycle(result.precedence, err);
+		message = err.str();
+		message.pop_back();
+		response.field("warning", message);
+	}
+}
+
+static std::string answer(const std::string& request, std::size_t line,
+                          const Request_options& defaults)
+{
+	auto out = std::ostringstream();
+	answer(out, request, line, defaults);
+	return out.str();
+}
+
+static bool is_blank(const std::string& line)
+{
+	return line.find_first_not_of(" \t\r\n") == std::string::npos;
+}
+
+// Answers the requests on standard input (one per line) until its end.
+static void serve(const Request_options& defaults)
+{
+	std::string line;
+	std::size_t line_number = 0;
+	while (std::getline(std::cin, line)) {
+		line_number++;
+		if (!is_blank(line))
+			std::cout << answer(line, line_number, defaults) << std::endl;
+	}
+}
+
+#ifndef _WIN32
+
+static bool write_all(int fd, const std::string& data)
+{
+	const char* p = data.data();
+	std::size_t left = data.size();
+	while (left > 0) {
+		ssize_t n = write(fd, p, left);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			return false;
+		}
+		p += n;
+		left -= n;
+	}
+	return true;
+}
+
+// the socket to remove when the server is stopped
+static char socket_path[sizeof(sockaddr_un::sun_path)];
+
+static void stop_serving(int)
+{
+	unlink(socket_path);
+	_exit(0);
+}
+
+// Answers the requests on the connections to a Unix domain socket at
+// path, one connection after the other, until the server is stopped
+// (with SIGINT or SIGTERM).
+static int serve(const std::string& path, const Request_options& defaults)
+{
+	if (path.size() >= sizeof(socket_path)) {
+		std::cerr << path << ": socket path too long" << std::endl;
+		return 1;
+	}
+	std::strcpy(socket_path, path.c_str());
+
+	int server = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (server < 0) {
+		std::cerr << path << ": " << std::strerror(errno) << std::endl;
+		return 1;
+	}
+
+	// replace a stale socket, but nothing else
+	struct stat st;
+	if (lstat(socket_path, &st) == 0 && S_ISSOCK(st.st_mode))
+		unlink(socket_path);
+
+	struct sockaddr_un addr;
+	std::memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	std::strcpy(addr.sun_path, socket_path);
+	if (bind(server, (struct sockaddr*) &addr, sizeof(addr)) < 0
+	    || listen(server, SOMAXCONN) < 0) {
+		std::cerr << path << ": " << std::strerror(errno) << std::endl;
+		close(server);
+		return 1;
+	}
+
+	signal(SIGINT, stop_serving);
+	signal(SIGTERM, stop_serving);
+	// a client that goes away must not take the server with it
+	signal(SIGPIPE, SIG_IGN);
+
+	while (true) {
+		int connection = accept(server, nullptr, nullptr);
+		if (connection < 0) {
+			if (errno == EINTR || errno == ECONNABORTED)
+				continue;
+			std::cerr << path << ": " << std::strerror(errno) << std::endl;
+			unlink(socket_path);
+			return 1;
+		}
+
+		FILE* in = fdopen(connection, "r");
+		char* line = nullptr;
+		std::size_t capacity = 0;
+		std::size_t line_number = 0;
+		ssize_t length;
+		while ((length = getline(&line, &capacity, in)) >= 0) {
+			line_number++;
+			std::string request(line, length);
+			if (is_blank(request))
+				continue;
+			auto response = answer(request, line_number, defaults) + "\n";
+			if (!write_all(connection, response))
+				break;
+		}
+		free(line);
+		fclose(in);
 	}
 }
 
+#endif
+
 static void print_header(){
 	std::cout << "# file name"
 	          << ", schedulable?"
@@ -268,8 +938,19 @@ static void print_header(){
 	          << ", CPU time"
 	          << ", memory"
 	          << ", timeout"
-	          << ", #CPUs"
-	          << std::endl;
+	          << ", #CPUs";
+	if (want_stats)
+		std::cout << ", key collisions"
+		          << ", arena memory"
+		          << ", setup memory"
+		          << ", #buckets"
+		          << ", mean bucket size"
+		          << ", max bucket size"
+		          << ", #precedence constraints"
+		          << ", #redundant constraints"
+		          << ", decompression speed"
+		          << ", parse speed";
+	std::cout << std::endl;
 }
 
 int main(int argc, char** argv)
@@ -304,23 +985,71 @@ int main(int argc, char** argv)
 	      .help("name of the file that contains the job set's precedence DAG")
 	      .set_default("");
 
+	parser.add_option("--reduce-precedence").dest("reduce_precedence")
+	      .set_default("0")
+	      .action("store_const").set_const("1")
+	      .help("drop precedence constraints that are duplicates or implied "
+	            "by others (can change the results of the global analysis; "
+	            "default: off)");
+
 	parser.add_option("-a", "--abort-actions").dest("abort_file")
 	      .help("name of the file that contains the job set's abort actions")
 	      .set_default("");
 
+	parser.add_option("--convert").dest("convert_file")
+	      .metavar("FILE")
+	      .help("instead of analyzing the job set, write it (with its "
+	            "precedence constraints and abort actions) to FILE in the "
+	            "binary job set format (in the time model given by -t)")
+	      .set_default("");
+
 	parser.add_option("-m", "--multiprocessor").dest("num_processors")
 	      .help("set the number of processors of the platform")
 	      .set_default("1");
 
 	parser.add_option("--threads").dest("num_threads")
-	      .help("set the number of worker threads (parallel analysis)")
+	      .help("set the number of worker threads (parallel analysis; "
+	            "also enables the parallel uniprocessor analysis unless 1)")
 	      .set_default("0");
 
+	parser.add_option("--jobs").dest("num_jobs")
+	      .metavar("N")
+	      .help("analyze up to N job set files at once (default: 1)")
+	      .set_default("1");
+
+	parser.add_option("--deterministic").dest("deterministic")
+	      .set_default("0")
+	      .action("store_const").set_const("1")
+	      .help("make the parallel global analysis yield exactly the results "
+	            "of a sequential run (default: off)");
+
+	parser.add_option("--serve").dest("serve").set_default("0")
+	      .action("store_const").set_const("1")
+	      .help("instead of analyzing the given job sets, answer analysis "
+	            "requests (JSON objects, one per line) on standard input "
+	            "until its end (see README)");
+
+	parser.add_option("--socket").dest("socket")
+	      .metavar("PATH")
+	      .help("with --serve, accept requests on connections to a Unix "
+	            "domain socket at PATH instead")
+	      .set_default("");
+
 	parser.add_option("--header").dest("print_header")
 	      .help("print a column header")
 	      .action("store_const").set_const("1")
 	      .set_default("0");
 
+	parser.add_option("--stats").dest("stats")
+	      .help("print additional analysis statistics (extra columns)")
+	      .action("store_const").set_const("1")
+	      .set_default("0");
+
+	parser.add_option("--no-arenas").dest("no_arenas").set_default("0")
+	      .action("store_const").set_const("1")
+	      .help("allocate states individually instead of from per-depth "
+	            "arenas (default: use arenas)");
+
 	parser.add_option("-g", "--save-graph").dest("dot").set_default("0")
 	      .action("store_const").set_const("1")
 	      .help("store the state graph in Graphviz dot format (default: off)");
@@ -366,6 +1095,8 @@ int main(int argc, char** argv)
 	}
 	precedence_file = (const std::string&) options.get("precedence_file");
 
+	want_reduced_precedence = options.get("reduce_precedence");
+
 	want_aborts = options.is_set_by_user("abort_file");
 	if (want_aborts && parser.args().size() > 1) {
 		std::cerr << "[!!] Warning: multiple job sets "
@@ -374,6 +1105,14 @@ int main(int argc, char** argv)
 	}
 	aborts_file = (const std::string&) options.get("abort_file");
 
+	want_convert = options.is_set_by_user("convert_file");
+	if (want_convert && parser.args().size() > 1) {
+		std::cerr << "Error: only one job set can be converted at a time"
+		          << std::endl;
+		return 1;
+	}
+	convert_file = (const std::string&) options.get("convert_file");
+
 	want_multiprocessor = options.is_set_by_user("num_processors");
 	num_processors = options.get("num_processors");
 	if (!num_processors || num_processors > MAX_PROCESSORS) {
@@ -381,8 +1120,18 @@ int main(int argc, char** argv)
 		return 1;
 	}
 
+	num_jobs = options.get("num_jobs");
+	if (!num_jobs) {
+		std::cerr << "Error: invalid number of jobs\n" << std::endl;
+		return 1;
+	}
+
 	want_rta_file = options.get("rta");
 
+	want_stats = options.get("stats");
+
+	want_arenas = !options.get("no_arenas");
+
 	continue_after_dl_miss = options.get("go_on_after_dl");
 
 #ifdef CONFIG_COLLECT_SCHEDULE_GRAPH
@@ -398,6 +1147,10 @@ int main(int argc, char** argv)
 
 #ifdef CONFIG_PARALLEL
 	num_worker_threads = options.get("num_threads");
+	// the uniprocessor analysis is parallelized only upon request
+	want_parallel_uniproc = options.is_set_by_user("num_threads")
+	                        && num_worker_threads != 1;
+	want_deterministic = options.get("deterministic");
 #else
 	if (options.is_set_by_user("num_threads")) {
 		std::cerr << "Error: parallel analysis must be enabled "
@@ -407,14 +1160,56 @@ int main(int argc, char** argv)
 	}
 #endif
 
+#ifdef CONFIG_PARALLEL
+	// the analyses of all files share these worker threads
+	tbb::global_control init(
+		tbb::global_control::max_allowed_parallelism,
+		num_worker_threads ?
+			num_worker_threads : tbb::this_task_arena::max_concurrency());
+#endif
+
+	if (options.get("serve")) {
+		if (!parser.args().empty()) {
+			std::cerr << "Error: no job set files can be given with --serve"
+			          << std::endl;
+			return 1;
+		}
+		// the command-line options are the defaults of all requests
+		auto defaults = current_options();
+		if (options.is_set_by_user("socket")) {
+#ifndef _WIN32
+			return serve((const std::string&) options.get("socket"),
+			             defaults);
+#else
+			std::cerr << "Error: --socket is not supported on Windows"
+			          << std::endl;
+			return 1;
+#endif
+		}
+		serve(defaults);
+		return 0;
+	}
+
 	if (options.get("print_header"))
 		print_header();
 
-	for (auto f : parser.args())
-		process_file(f);
+	std::vector<std::string> files = parser.args();
+	if (files.empty())
+		files.push_back("-");
 
-	if (parser.args().empty())
-		process_file("-");
+	// a single file is analyzed on its own (and with the CPU-time clock)
+	if (files.size() == 1)
+		num_jobs = 1;
+
+	if (num_jobs > 1)
+		return process_files(files);
+
+	for (const auto& f : files) {
+		auto report = process_file(f);
+		print_report(report);
+		if (report.exit_code)
+			return report.exit_code;
+	}
 
 	return 0;
 }
@@ -2,9 +2,22 @@
 #include "doctest.h"
 
 #include <algorithm>
+#include <deque>
 #include <iostream>
+#include <map>
+#include <unordered_set>
+#include <vector>
 
 #include "index_set.hpp"
+#include "index_set_pool.hpp"
+#include "zobrist.hpp"
+#include "arena.hpp"
+#include "response_times.hpp"
+#include "sorted_index.hpp"
+#include "job_table.hpp"
+#ifdef CONFIG_PARALLEL
+#include "sharded_cache.hpp"
+#endif
 #include "jobs.hpp"
 #include "uni/space.hpp"
 
@@ -55,6 +68,51 @@ TEST_CASE("Job hashes work") {
 }
 
 
+TEST_CASE("Zobrist keys") {
+	NP::Zobrist_keys k1(1000), k2(1000), k3(1000, 42);
+
+	std::unordered_set<hash_value_t> seen;
+	for (std::size_t i = 0; i < 1000; i++) {
+		// deterministic for a given seed
+		CHECK(k1[i] == k2[i]);
+		CHECK(k1[i] != k3[i]);
+		seen.insert(k1[i]);
+	}
+	CHECK(seen.size() == 1000);
+
+	// a state's key, built up one transition at a time, is the XOR of
+	// the keys of its scheduled jobs, whatever order they were added in
+	typedef NP::Uniproc::Schedule_state<dtime_t> State;
+	typedef NP::Uniproc::Job_set Job_set;
+	NP::Uniproc::Pending_jobs<dtime_t> p{0, 0, 0};
+	auto follow = [&] (const std::vector<std::size_t>& order,
+	                   std::deque<Job_set>& sets, std::deque<State>& path) {
+		sets.emplace_back();
+		path.emplace_back();
+		for (auto j : order) {
+			sets.emplace_back(sets.back(), j);
+			path.emplace_back(path.back(), k1[j], sets.back(),
+			                  Interval<dtime_t>{0, 0}, p);
+		}
+		return path.back().get_key();
+	};
+	std::deque<Job_set> sets1, sets2;
+	std::deque<State> path1, path2;
+	auto key1 = follow({1, 2, 3, 999}, sets1, path1);
+	auto key2 = follow({999, 3, 1, 2}, sets2, path2);
+	CHECK(key1 == key2);
+
+	hash_value_t expected = 0;
+	for (std::size_t i = 0; i < 1000; i++)
+		if (path1.back().get_scheduled_jobs().contains(i))
+			expected ^= k1[i];
+	CHECK(key1 == expected);
+
+	// states that differ in one job differ in their keys
+	CHECK(path1[3].get_key() != path2[3].get_key());
+}
+
+
 TEST_CASE("Interval LUT") {
 
 	Interval_lookup_table<dtime_t, Job<dtime_t>, &Job<dtime_t>::scheduling_window> lut(Interval<dtime_t>(0, 60), 10);
@@ -70,6 +128,49 @@ TEST_CASE("Interval LUT") {
 	CHECK(count == 1);
 }
 
+TEST_CASE("Balanced interval LUT") {
+	typedef Interval_lookup_table<dtime_t, Job<dtime_t>, &Job<dtime_t>::scheduling_window> Lut;
+
+	// a burst of short jobs early on, and a few long ones
+	Job<dtime_t>::Job_set jobs;
+	for (unsigned long i = 0; i < 50; i++)
+		jobs.push_back(Job<dtime_t>{i, Interval<dtime_t>(dtime_t(i % 10), dtime_t(i % 10)),
+		                            Interval<dtime_t>(1, 1), dtime_t(20 + i % 10), 1});
+	for (unsigned long i = 50; i < 55; i++)
+		jobs.push_back(Job<dtime_t>{i, Interval<dtime_t>(dtime_t(i * 100), dtime_t(i * 100)),
+		                            Interval<dtime_t>(1, 1), 10000, 1});
+
+	Interval<dtime_t> range(0, 10000);
+	Lut uniform(range, 10000 / 10);
+	Lut balanced(range, Lut::balanced_bucket_starts(range, jobs, 10));
+
+	auto expected = balanced.occupancy_with(jobs);
+	for (const auto& j : jobs) {
+		uniform.insert(j);
+		balanced.insert(j);
+	}
+
+	auto u = uniform.occupancy();
+	auto b = balanced.occupancy();
+	CHECK(b.buckets == expected.buckets);
+	CHECK(b.entries == expected.entries);
+	CHECK(b.largest == expected.largest);
+	CHECK(b.typical == expected.typical);
+	CHECK(b.typical < u.typical);
+
+	// every job whose window contains t is found
+	for (dtime_t t = 0; t < 10000; t += 7) {
+		for (const Lut* lut : {&uniform, &balanced}) {
+			std::size_t found = 0, overlapping = 0;
+			for (const auto& j : jobs)
+				overlapping += j.scheduling_window().contains(t);
+			for (const Job<dtime_t>& j : lut->lookup(t))
+				found += j.scheduling_window().contains(t);
+			CHECK(found == overlapping);
+		}
+	}
+}
+
 
 TEST_CASE("state space") {
 
@@ -151,3 +252,272 @@ TEST_CASE("[basic] index set")
 	CHECK(!all.includes(c));
 }
 
+
+TEST_CASE("[basic] packed index set")
+{
+	NP::Packed_index_set empty;
+	NP::Packed_index_set all;
+
+	CHECK(empty.is_subset_of(all));
+	CHECK(empty.size() == 0);
+
+	all.add(10);
+	all.add(20);
+	all.add(130);
+
+	CHECK(all.contains(10));
+	CHECK(!all.contains(29));
+	CHECK(!all.contains(1000));
+	CHECK(all.contains(130));
+	CHECK(all.size() == 3);
+
+	CHECK(!all.is_subset_of(empty));
+
+	NP::Packed_index_set some;
+	some.add(10);
+	some.add(20);
+
+	CHECK(some.is_subset_of(all));
+	CHECK(!all.is_subset_of(some));
+	CHECK(all.includes(some));
+	CHECK(!some.includes(all));
+	CHECK(some.size() == 2);
+
+	std::vector<std::size_t> a{10, 20};
+	std::vector<std::size_t> b{130, 20};
+	std::vector<std::size_t> c{130, 140};
+
+	CHECK(all.includes(a));
+	CHECK(all.includes(b));
+	CHECK(!all.includes(c));
+
+	// cloning preserves all bits and adds one, across word boundaries
+	NP::Packed_index_set more{some, 130};
+	CHECK(more.size() == 3);
+	CHECK(more == all);
+	CHECK(more != some);
+
+	NP::Packed_index_set fewer{some, 63};
+	CHECK(fewer.contains(63));
+	CHECK(!fewer.contains(64));
+	CHECK(fewer != all);
+
+	// equality ignores how the sets were grown
+	NP::Packed_index_set x{empty, 5};
+	NP::Packed_index_set y{all, 5};
+	NP::Packed_index_set z{x, 10};
+	CHECK(x != y);
+	z.add(20);
+	z.add(130);
+	CHECK(z == y);
+
+	NP::Packed_index_set diff{all, some};
+	CHECK(diff.size() == 1);
+	CHECK(diff.contains(130));
+}
+
+TEST_CASE("[basic] index set pool")
+{
+	NP::Index_set_pool<NP::Packed_index_set> pool;
+
+	const auto& empty = NP::empty_index_set<NP::Packed_index_set>();
+
+	const auto& a = pool.intern(empty, 3, 1);
+	const auto& b = pool.intern(empty, 70, 2);
+	CHECK(&a != &b);
+	CHECK(pool.size() == 2);
+
+	// same set via different paths => same object
+	const auto& ab = pool.intern(a, 70, 3);
+	const auto& ba = pool.intern(b, 3, 3);
+	CHECK(&ab == &ba);
+	CHECK(pool.size() == 3);
+	CHECK(ab.size() == 2);
+	CHECK(ab.contains(3));
+	CHECK(ab.contains(70));
+
+	// key collisions are resolved by comparing the sets
+	const auto& c = pool.intern(empty, 4, 3);
+	CHECK(&c != &ab);
+	CHECK(pool.size() == 4);
+	CHECK(&pool.intern(empty, 4, 3) == &c);
+}
+
+TEST_CASE("[basic] arena")
+{
+	NP::Arena arena;
+
+	CHECK(arena.bytes_reserved() == 0);
+
+	auto a = static_cast<char*>(arena.allocate(3, 1));
+	auto b = static_cast<char*>(arena.allocate(8, 8));
+	CHECK(reinterpret_cast<std::uintptr_t>(b) % 8 == 0);
+	CHECK(b >= a + 3);
+	CHECK(arena.bytes_reserved() >= 11);
+
+	// the most recent allocation can be given back
+	arena.deallocate(b, 8);
+	CHECK(arena.allocate(8, 8) == b);
+
+	// but nothing else
+	arena.deallocate(a, 3);
+	CHECK(arena.allocate(1, 1) == b + 8);
+
+	// requests larger than a chunk still work
+	auto reserved = arena.bytes_reserved();
+	arena.allocate(4 * NP::Arena::max_chunk_size);
+	CHECK(arena.bytes_reserved() >= reserved + 4 * NP::Arena::max_chunk_size);
+
+	// sets and pools can be placed in an arena
+	NP::Index_set_pool<NP::Packed_index_set> pool(&arena);
+	const auto& empty = NP::empty_index_set<NP::Packed_index_set>();
+	const auto& x = pool.intern(empty, 100, 1);
+	const auto& y = pool.intern(x, 1, 2);
+	CHECK(y.contains(1));
+	CHECK(y.contains(100));
+	CHECK(y.size() == 2);
+	CHECK(&pool.intern(x, 1, 2) == &y);
+}
+
+TEST_CASE("[basic] response times")
+{
+	NP::Response_times<dtime_t> rt(3);
+
+	CHECK(rt.size() == 3);
+	CHECK(!rt.contains(0));
+	CHECK(!rt.contains(2));
+
+	rt.update(1, Interval<dtime_t>{5, 10});
+	CHECK(rt.contains(1));
+	CHECK(rt[1] == Interval<dtime_t>(5, 10));
+
+	rt.update(1, Interval<dtime_t>{7, 12});
+	CHECK(rt[1] == Interval<dtime_t>(5, 12));
+
+	NP::Response_times<dtime_t> other(3);
+	other.update(1, Interval<dtime_t>{0, 3});
+	other.update(2, Interval<dtime_t>{4, 4});
+
+	rt.merge(other);
+	CHECK(!rt.contains(0));
+	CHECK(rt[1] == Interval<dtime_t>(0, 12));
+	CHECK(rt[2] == Interval<dtime_t>(4, 4));
+}
+
+TEST_CASE("[basic] sorted index")
+{
+	NP::Sorted_index<int, int> empty;
+	CHECK(empty.lower_bound(0) == empty.end());
+	CHECK(empty.upper_bound(0) == empty.end());
+
+	// compare against a multimap, for all sizes of small trees and
+	// with plenty of duplicate keys
+	for (int n = 1; n < 40; n++) {
+		std::vector<std::pair<int, int>> entries;
+		std::multimap<int, int> reference;
+		for (int i = 0; i < n; i++) {
+			int key = (i * 7919) % (n / 2 + 1);
+			entries.emplace_back(key, i);
+			reference.insert({key, i});
+		}
+
+		NP::Sorted_index<int, int> index(entries);
+		CHECK(index.size() == n);
+		CHECK(std::equal(index.begin(), index.end(), reference.begin(),
+			[] (const std::pair<int, int>& a, const std::pair<const int, int>& b) {
+				return a.first == b.first && a.second == b.second;
+			}));
+
+		for (int k = -1; k <= n / 2 + 2; k++) {
+			CHECK(index.lower_bound(k) - index.begin()
+			      == std::distance(reference.begin(), reference.lower_bound(k)));
+			CHECK(index.upper_bound(k) - index.begin()
+			      == std::distance(reference.begin(), reference.upper_bound(k)));
+		}
+	}
+}
+
+TEST_CASE("[basic] job scan list")
+{
+	// 70 jobs, so that the scheduled set spans more than one word
+	Job<dtime_t>::Job_set jobs;
+	for (unsigned long i = 0; i < 70; i++) {
+		dtime_t arrival = (i * 37) % 101;
+		jobs.push_back(Job<dtime_t>{i, Interval<dtime_t>(arrival, arrival + 5),
+		                            Interval<dtime_t>(1, 2), 200,
+		                            dtime_t(i % 4), i % 3});
+	}
+
+	NP::Job_table<dtime_t> table(jobs);
+	NP::Job_scan_list<dtime_t> list;
+	for (unsigned int i = 0; i < jobs.size(); i++)
+		list.push_back(table, i);
+
+	for (std::size_t r = 0; r < jobs.size(); r++)
+		for (std::size_t k = 0; k < jobs.size(); k++)
+			CHECK((table.rank(k) < table.rank(r))
+			      == jobs[k].higher_priority_than(jobs[r]));
+
+	Job_index_set scheduled;
+	for (std::size_t step = 0; step < jobs.size(); step += 3) {
+		for (std::size_t ref = 0; ref < jobs.size(); ref += 7) {
+			dtime_t expected = inf;
+			for (std::size_t k = 0; k < jobs.size(); k++)
+				if (!scheduled.contains(k)
+				    && jobs[k].higher_priority_than(jobs[ref]))
+					expected = std::min(expected, jobs[k].latest_arrival());
+
+			CHECK(list.min_latest_arrival(scheduled, table.rank(ref))
+			      == expected);
+			CHECK(list.scalar_min_latest_arrival(scheduled, table.rank(ref))
+			      == expected);
+		}
+		scheduled.add(step);
+	}
+}
+
+#ifdef CONFIG_PARALLEL
+
+TEST_CASE("[basic] sharded cache")
+{
+	NP::Sharded_cache<int> cache;
+
+	// deliberately too small, so that some keys overflow
+	cache.reset(10);
+
+	const int n = 10000;
+	tbb::parallel_for(0, n, [&] (int i) {
+		// keys 0..n/2-1, each inserted twice; key 0 is special
+		NP::hash_value_t key = (i / 2) * 0x9e3779b97f4a7c15ULL;
+		cache.with_entry(key, [&] (NP::Sharded_cache<int>::Refs& refs) {
+			refs.push_front(i);
+			return 0;
+		});
+	});
+
+	CHECK(cache.number_of_overflows() > 0);
+
+	for (int k = 0; k < n / 2; k++) {
+		NP::hash_value_t key = k * 0x9e3779b97f4a7c15ULL;
+		auto count = cache.with_entry(key,
+			[&] (NP::Sharded_cache<int>::Refs& refs) {
+				int c = 0;
+				for (int i : refs) {
+					CHECK(i / 2 == k);
+					c++;
+				}
+				return c;
+			});
+		CHECK(count == 2);
+	}
+
+	// after a reset, everything is gone
+	cache.reset(n);
+	CHECK(cache.number_of_overflows() == 0);
+	CHECK(cache.with_entry(0x9e3779b97f4a7c15ULL,
+		[] (NP::Sharded_cache<int>::Refs& refs) {
+			return refs.empty();
+		}));
+}
+
+#endif
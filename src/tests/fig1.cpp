@@ -72,6 +72,31 @@ TEST_CASE("Example in Figure 1(a,b)") {
 		CHECK(ftimes.min() == 38);
 		CHECK(ftimes.max() == 40);
 	}
+
+#ifdef CONFIG_PARALLEL
+	SUBCASE("Parallel exploration") {
+		Scheduling_problem<dtime_t> prob{jobs};
+		for (bool early_exit : {true, false}) {
+			Analysis_options opts;
+			opts.early_exit = early_exit;
+			auto seq = Uniproc::State_space<dtime_t>::explore(prob, opts);
+			opts.parallel = true;
+			auto par = Uniproc::State_space<dtime_t>::explore(prob, opts);
+
+			CHECK(!par.is_schedulable());
+			CHECK(par.number_of_states() == seq.number_of_states());
+			CHECK(par.number_of_edges() == seq.number_of_edges());
+			CHECK(par.max_exploration_front_width()
+			      == seq.max_exploration_front_width());
+			for (const auto& j : jobs) {
+				CHECK(par.get_finish_times(j).min()
+				      == seq.get_finish_times(j).min());
+				CHECK(par.get_finish_times(j).max()
+				      == seq.get_finish_times(j).max());
+			}
+		}
+	}
+#endif
 }
 
 
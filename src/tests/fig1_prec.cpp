@@ -2,6 +2,7 @@
 
 #include <iostream>
 #include <sstream>
+#include <algorithm>
 
 #include "io.hpp"
 #include "uni/space.hpp"
@@ -87,6 +88,109 @@ TEST_CASE("[prec] handle cycles gracefully") {
 	CHECK_FALSE(space.is_schedulable());
 }
 
+TEST_CASE("[prec] report cycles") {
+	auto dag_in = std::istringstream(prec_dag_file_with_cycle);
+	auto in = std::istringstream(fig1a_jobs_file);
+
+	Scheduling_problem<dtime_t> prob{
+		parse_file<dtime_t>(in),
+		parse_dag_file(dag_in)};
+
+	CHECK_FALSE(prob.precedence.is_acyclic());
+	CHECK(prob.precedence.cycle.size() == 6);
+	// each job in the cycle precedes the next one
+	const auto& cycle = prob.precedence.cycle;
+	for (std::size_t i = 0; i < cycle.size(); i++)
+		CHECK(cycle[(i + 1) % cycle.size()].job == cycle[i].job % 6 + 1);
+
+	// cyclic constraints are used as given
+	CHECK(prob.dag.size() == 8);
+	CHECK(prob.precedence.redundant_edges == 0);
+}
+
+const std::string prec_dag_file_redundant =
+"Predecessor TID,	Predecessor JID,	Successor TID, Successor JID\n"
+"1, 1,    1, 2\n"
+"1, 2,    1, 3\n"
+"1, 1,    1, 3\n" // implied by 1 -> 2 -> 3
+"1, 3,    1, 4\n"
+"1, 1,    1, 4\n" // implied by 1 -> 3 -> 4
+"1, 4,    1, 5\n"
+"1, 5,    1, 6\n"
+"1, 5,    1, 6\n" // duplicate
+"2, 7,    2, 8\n"
+"1, 2,    3, 9\n";
+
+TEST_CASE("[prec] keep redundant constraints by default") {
+	auto dag_in = std::istringstream(prec_dag_file_redundant);
+	auto in = std::istringstream(fig1a_jobs_file);
+
+	Scheduling_problem<dtime_t> prob{
+		parse_file<dtime_t>(in),
+		parse_dag_file(dag_in)};
+
+	CHECK(prob.precedence.is_acyclic());
+	CHECK(prob.precedence.given_edges == 10);
+	CHECK(prob.precedence.redundant_edges == 0);
+	CHECK(prob.dag.size() == 10);
+
+	// every job is ranked after its predecessors, and each job's
+	// predecessors come in reverse topological order
+	const auto& rank = prob.precedence.topological_rank;
+	REQUIRE(rank.size() == prob.jobs.size());
+	auto rank_of = [&] (JobID id) {
+		return rank[prob.job_index.index_of(id)];
+	};
+	for (std::size_t k = 0; k < prob.dag.size(); k++) {
+		const auto& e = prob.dag[k];
+		CHECK(rank_of(e.first) < rank_of(e.second));
+		if (k == 0)
+			continue;
+		const auto& prev = prob.dag[k - 1];
+		CHECK(rank_of(prev.second) <= rank_of(e.second));
+		if (prev.second == e.second)
+			CHECK(rank_of(prev.first) >= rank_of(e.first));
+	}
+	// job 6 has only job 5 as predecessor (twice)
+	CHECK(prob.dag[8].second == JobID(6, 1));
+	CHECK(prob.dag[9].second == JobID(6, 1));
+}
+
+TEST_CASE("[prec] drop redundant constraints") {
+	auto dag_in = std::istringstream(prec_dag_file_redundant);
+	auto in = std::istringstream(fig1a_jobs_file);
+
+	Scheduling_problem<dtime_t> prob{
+		parse_file<dtime_t>(in),
+		parse_dag_file(dag_in)};
+	prob.drop_redundant_precedence();
+
+	CHECK(prob.precedence.is_acyclic());
+	CHECK(prob.precedence.given_edges == 10);
+	CHECK(prob.precedence.redundant_edges == 3);
+	CHECK(prob.dag.size() == 7);
+
+	// exactly the constraints without the redundant ones remain
+	auto dag_in2 = std::istringstream(prec_dag_file);
+	auto in2 = std::istringstream(fig1a_jobs_file);
+	Scheduling_problem<dtime_t> reduced{
+		parse_file<dtime_t>(in2),
+		parse_dag_file(dag_in2)};
+	for (const auto& e : reduced.dag)
+		CHECK(std::find(prob.dag.begin(), prob.dag.end(), e)
+		      != prob.dag.end());
+
+	// same result as without the redundant constraints
+
+	Analysis_options opts;
+	auto space = Uniproc::State_space<dtime_t>::explore(prob, opts);
+	auto expected = Uniproc::State_space<dtime_t>::explore(reduced, opts);
+	CHECK(space.is_schedulable());
+	for (std::size_t i = 0; i < prob.jobs.size(); i++)
+		CHECK(space.get_finish_times(prob.jobs[i])
+		      == expected.get_finish_times(reduced.jobs[i]));
+}
+
 const std::string deadend_jobs_file =
 "   Task ID,     Job ID,          Arrival min,          Arrival max,             Cost min,             Cost max,             Deadline,             Priority\n"
 "1, 1,  0,  0, 1,  2, 10, 10\n"
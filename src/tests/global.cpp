@@ -6,6 +6,10 @@
 #include "io.hpp"
 #include "global/space.hpp"
 
+#ifdef CONFIG_PARALLEL
+#include "tbb/global_control.h"
+#endif
+
 const std::string fig1a_jobs_file =
 "   Task ID,     Job ID,          Arrival min,          Arrival max,             Cost min,             Cost max,             Deadline,             Priority\n"
 "1, 1,  0,  0, 1,  2, 10, 10\n"
@@ -20,17 +24,18 @@ const std::string fig1a_jobs_file =
 
 
 TEST_CASE("[global-prec] basic state evolution (RTSS18-Fig-3)") {
+	NP::Global::Job_set_pool pool;
 	NP::Global::Schedule_state<dtime_t> init(2);
 
 	CHECK(init.core_availability().min() == 0);
 	CHECK(init.core_availability().max() == 0);
 
-	NP::Global::Schedule_state<dtime_t> v1{init, 1, {}, {0, 0}, {5, 15}, 0};
+	NP::Global::Schedule_state<dtime_t> v1{init, 1, {}, {0, 0}, {5, 15}, 0, pool};
 
 	CHECK(v1.core_availability().min() == 0);
 	CHECK(v1.core_availability().max() == 0);
 
-	NP::Global::Schedule_state<dtime_t> vp{v1, 2, {}, {0, 0}, {12, 30}, 0};
+	NP::Global::Schedule_state<dtime_t> vp{v1, 2, {}, {0, 0}, {12, 30}, 0, pool};
 
 	CHECK(vp.core_availability().min() ==  5);
 	CHECK(vp.core_availability().max() == 15);
@@ -38,7 +43,7 @@ TEST_CASE("[global-prec] basic state evolution (RTSS18-Fig-3)") {
 	CHECK(!vp.can_merge_with(init));
 	CHECK(!vp.can_merge_with(v1));
 
-	NP::Global::Schedule_state<dtime_t> v2{init, 2, {}, {0, 0}, {10, 25}, 0};
+	NP::Global::Schedule_state<dtime_t> v2{init, 2, {}, {0, 0}, {10, 25}, 0, pool};
 
 	CHECK(v1.core_availability().min() == 0);
 	CHECK(v1.core_availability().max() == 0);
@@ -46,7 +51,7 @@ TEST_CASE("[global-prec] basic state evolution (RTSS18-Fig-3)") {
 	CHECK(!v2.can_merge_with(v1));
 	CHECK(!v2.try_to_merge(v1));
 
-	NP::Global::Schedule_state<dtime_t> vq{v2, 1, {}, {0, 0}, {8, 20}, 0};
+	NP::Global::Schedule_state<dtime_t> vq{v2, 1, {}, {0, 0}, {8, 20}, 0, pool};
 
 	CHECK(vq.core_availability().min() ==  8);
 	CHECK(vq.core_availability().max() == 20);
@@ -63,6 +68,42 @@ TEST_CASE("[global-prec] basic state evolution (RTSS18-Fig-3)") {
 	CHECK(vp.core_availability().max() == 20);
 }
 
+TEST_CASE("[global-prec] dispatched jobs track blocked jobs") {
+	// 0 -> 2, 1 -> 2, 2 -> 3
+	NP::Global::Job_dependencies deps(4);
+	deps.predecessors[2] = {0, 1};
+	deps.predecessors[3] = {2};
+	deps.successors[0] = {2};
+	deps.successors[1] = {2};
+	deps.successors[2] = {3};
+
+	NP::Global::Job_set_pool pool;
+	NP::Global::Dispatched_jobs none(deps);
+
+	CHECK(none.ready(0));
+	CHECK(none.ready(1));
+	CHECK(!none.ready(2));
+	CHECK(!none.ready(3));
+
+	const auto& d0 = pool.intern(none, 0, 1);
+	CHECK(!d0.ready(0));
+	CHECK(d0.ready(1));
+	CHECK(!d0.ready(2));
+
+	const auto& d01 = pool.intern(d0, 1, 3);
+	CHECK(d01.ready(2));
+	CHECK(!d01.ready(3));
+
+	// the same set via the other path
+	const auto& d1 = pool.intern(none, 1, 2);
+	CHECK(&pool.intern(d1, 0, 3) == &d01);
+
+	const auto& d012 = pool.intern(d01, 2, 7);
+	CHECK(!d012.ready(2));
+	CHECK(d012.ready(3));
+	CHECK(d012.jobs().size() == 3);
+}
+
 TEST_CASE("[global] RTSS17-Fig-1a") {
 	auto in = std::istringstream(fig1a_jobs_file);
 	auto jobs = NP::parse_file<dtime_t>(in);
@@ -406,3 +447,45 @@ TEST_CASE("[global] explore across bucket boundaries") {
 	CHECK(space.number_of_edges() == 3);
 }
 
+
+#ifdef CONFIG_PARALLEL
+TEST_CASE("[global] deterministic parallel exploration") {
+	auto in = std::istringstream(fig1a_jobs_file);
+	auto jobs = NP::parse_file<dtime_t>(in);
+
+	NP::Scheduling_problem<dtime_t> prob{jobs, 2};
+	NP::Analysis_options opts;
+	opts.deterministic = true;
+
+	auto ref = NP::Global::State_space<dtime_t>::explore(prob, opts);
+	CHECK(ref.is_schedulable());
+
+	for (int threads : {1, 2, 5}) {
+		tbb::global_control limit(
+			tbb::global_control::max_allowed_parallelism, threads);
+		auto space = NP::Global::State_space<dtime_t>::explore(prob, opts);
+
+		CHECK(space.is_schedulable());
+		CHECK(space.number_of_states() == ref.number_of_states());
+		CHECK(space.number_of_edges() == ref.number_of_edges());
+		CHECK(space.max_exploration_front_width()
+		      == ref.max_exploration_front_width());
+		for (const auto& j : jobs)
+			CHECK(space.get_finish_times(j) == ref.get_finish_times(j));
+	}
+
+	// a depth with a deadline miss ends exactly where it would in a
+	// sequential run
+	NP::Job<dtime_t>::Job_set miss{
+		NP::Job<dtime_t>{1, Interval<dtime_t>(  100,   100),  Interval<dtime_t>(   2,    50),   200, 1},
+		NP::Job<dtime_t>{2, Interval<dtime_t>(    0,     0),  Interval<dtime_t>(1200,  1200),  5000, 2},
+		NP::Job<dtime_t>{3, Interval<dtime_t>(  200,   250),  Interval<dtime_t>( 2,    50),    6000, 3},
+	};
+
+	NP::Scheduling_problem<dtime_t> miss_prob{miss, 1};
+	auto space = NP::Global::State_space<dtime_t>::explore(miss_prob, opts);
+	CHECK(!space.is_schedulable());
+	CHECK(space.number_of_edges() == 2);
+	CHECK(space.number_of_states() == 3);
+}
+#endif
@@ -62,6 +62,61 @@ const std::string ts3_edges =
 "       1,        0,        2,        0\n"
 "       2,        0,        3,        0\n";
 
+// a random DAG, as unrolled from a single task
+const std::string ts4_jobs =
+"Task ID, Job ID, Arrival min, Arrival max, Cost min, Cost max, Deadline, Priority\n"
+"      1,      1,          44,          49,        1,        1,      244,       59\n"
+"      1,      2,          25,          28,        1,        3,      225,       80\n"
+"      1,      3,          53,          58,        2,        5,      253,       54\n"
+"      1,      4,          41,          46,        4,        7,      241,       46\n"
+"      1,      5,          47,          52,        1,        4,      247,       53\n"
+"      1,      6,          53,          54,        1,        1,      253,       96\n"
+"      1,      7,          52,          57,        1,        2,      252,       87\n"
+"      1,      8,          44,          47,        3,        6,      244,       89\n"
+"      1,      9,          29,          32,        1,        1,      229,       62\n"
+"      1,     10,          27,          27,        5,        8,      227,       65\n"
+"      1,     11,          42,          44,        1,        4,      242,       18\n"
+"      1,     12,           4,           9,        1,        4,      204,       88\n"
+"      1,     13,          22,          23,        1,        4,      222,       83\n"
+"      1,     14,           2,           6,        1,        2,      202,       12\n"
+"      1,     15,           9,          11,        3,        6,      209,       12\n"
+"      1,     16,          27,          32,        1,        2,      227,       32\n"
+"      1,     17,          49,          54,        3,        6,      249,       44\n"
+"      1,     18,          25,          25,        7,       10,      225,       69\n"
+"      1,     19,          18,          18,        6,        9,      218,       86\n"
+"      1,     20,          60,          62,        1,        2,      260,       48\n";
+
+const std::string ts4_edges =
+"From TID, From JID,   To TID,   To JID\n"
+"       1,        1,        1,        3\n"
+"       1,        2,        1,        3\n"
+"       1,        1,        1,        4\n"
+"       1,        3,        1,        4\n"
+"       1,        2,        1,        4\n"
+"       1,        4,        1,        7\n"
+"       1,        3,        1,        7\n"
+"       1,        5,        1,        7\n"
+"       1,        2,        1,        8\n"
+"       1,        1,        1,        8\n"
+"       1,        3,        1,        8\n"
+"       1,        5,        1,        9\n"
+"       1,        6,        1,        9\n"
+"       1,        1,        1,       10\n"
+"       1,        8,        1,       13\n"
+"       1,       10,        1,       13\n"
+"       1,       14,        1,       15\n"
+"       1,        1,        1,       15\n"
+"       1,        6,        1,       16\n"
+"       1,        1,        1,       16\n"
+"       1,        2,        1,       17\n"
+"       1,        6,        1,       17\n"
+"       1,        5,        1,       18\n"
+"       1,        7,        1,       18\n"
+"       1,       14,        1,       18\n"
+"       1,        1,        1,       19\n"
+"       1,        5,        1,       19\n"
+"       1,       14,        1,       19\n";
+
 TEST_CASE("[global-prec] taskset-1") {
 	auto dag_in = std::istringstream(ts1_edges);
 	auto dag = NP::parse_dag_file(dag_in);
@@ -161,3 +216,36 @@ TEST_CASE("[global-prec] taskset-3") {
 
 	CHECK(space.is_schedulable());
 }
+
+TEST_CASE("[global-prec] taskset-4") {
+	auto dag_in = std::istringstream(ts4_edges);
+	auto dag = NP::parse_dag_file(dag_in);
+
+	auto in = std::istringstream(ts4_jobs);
+	auto jobs = NP::parse_file<dtime_t>(in);
+
+	NP::Scheduling_problem<dtime_t> prob{jobs, dag};
+	NP::Analysis_options opts;
+#ifdef CONFIG_PARALLEL
+	// the results of a sequential run
+	opts.deterministic = true;
+#endif
+
+	// Each state sees the finish times found by the states explored
+	// before it, even within the same depth, which matters here.
+	prob.num_processors = 2;
+	auto space2 = NP::Global::State_space<dtime_t>::explore(prob, opts);
+
+	CHECK(space2.is_schedulable());
+	CHECK(space2.number_of_states() == 170);
+	CHECK(space2.number_of_edges() == 433);
+	CHECK(space2.max_exploration_front_width() == 24);
+
+	prob.num_processors = 3;
+	auto space3 = NP::Global::State_space<dtime_t>::explore(prob, opts);
+
+	CHECK(space3.is_schedulable());
+	CHECK(space3.number_of_states() == 149);
+	CHECK(space3.number_of_edges() == 371);
+	CHECK(space3.max_exploration_front_width() == 23);
+}
@@ -4,6 +4,7 @@
 #include <sstream>
 
 #include "io.hpp"
+#include "json.hpp"
 
 const std::string one_line = "       920,          6,              50000.0,              50010.0,   23.227497252002234,    838.6724123730141,              60000.0,                    1";
 
@@ -154,3 +155,342 @@ TEST_CASE("[parser] valid precedence reference") {
 	// dummy check; real check is that previous line didn't throw an exception
 	CHECK(true);
 }
+
+TEST_CASE("[parser] job ID index") {
+	auto in = std::istringstream(four_lines);
+	auto jobs = NP::parse_file<dense_t>(in);
+
+	NP::Job_id_map index(jobs);
+
+	CHECK(index.size() == 3);
+	CHECK(index.index_of(NP::JobID(2, 920)) == 1);
+	CHECK(&NP::lookup<dense_t>(jobs, index, NP::JobID(3, 920)) == &jobs[2]);
+	CHECK(!index.contains(NP::JobID(4, 920)));
+	CHECK(index.find(NP::JobID(1, 921)) == std::size_t(NP::Job_id_map::npos));
+	REQUIRE_THROWS_AS(index.index_of(NP::JobID(4, 920)), NP::InvalidJobReference);
+}
+
+const std::string bad_jobs_file =
+"Task ID, Job ID, Arrival min, Arrival max, Cost min, Cost max, Deadline, Priority\n"
+"      1,      1,           0,           0,        1,        2,       10,       10\n"
+"      1,      2,          10,          10,        1,       2x,       20,       20\n";
+
+TEST_CASE("[parser] parse errors point to the bad field") {
+	auto in = std::istringstream(bad_jobs_file);
+
+	try {
+		NP::parse_file<dtime_t>(in);
+		FAIL("no parse error");
+	} catch (NP::Parse_error& e) {
+		CHECK(e.line == 3);
+		CHECK(e.column == 61);
+		CHECK(e.problem == "expected ','");
+	}
+}
+
+const std::string messy_jobs_file =
+"Task ID, Job ID, Arrival min, Arrival max, Cost min, Cost max, Deadline, Priority\r\n"
+"\r\n"
+"1,1,0,0,1,2,10,10\r\n"
+"\t1 ,\t2 , 10, 10, 1, 2, 20, 20, extra column\r\n"
+"\n";
+
+TEST_CASE("[parser] blank lines, CRLF, and extra columns") {
+	auto in = std::istringstream(messy_jobs_file);
+
+	auto jobs = NP::parse_file<dtime_t>(in);
+
+	REQUIRE(jobs.size() == 2);
+	CHECK(jobs[0].get_deadline() == 10);
+	CHECK(jobs[1].get_job_id() == 2);
+	CHECK(jobs[1].get_priority() == 20);
+}
+
+TEST_CASE("[parser] file split into chunks") {
+	std::string text = "Predecessor TID, Predecessor JID, Successor TID, Successor JID\n";
+	for (int i = 1; i <= 200; i++)
+		text += "1, " + std::to_string(i) + ", 1, " + std::to_string(i + 1) + "\n";
+
+	auto parse = [] (NP::Csv_reader& row) {
+		return NP::parse_precedence_constraint(row);
+	};
+
+	auto dag = NP::parse_rows<NP::Precedence_constraint>(
+		text.data(), text.data() + text.size(), "dag.csv", parse, 64);
+
+	REQUIRE(dag.size() == 200);
+	for (int i = 0; i < 200; i++) {
+		CHECK(dag[i].first.job == i + 1);
+		CHECK(dag[i].second.job == i + 2);
+	}
+
+	// row 150 is on line 151
+	auto pos = text.find("1, 150, 1, 151");
+	text[pos + 3] = 'x';
+	try {
+		NP::parse_rows<NP::Precedence_constraint>(
+			text.data(), text.data() + text.size(), "dag.csv", parse, 64);
+		FAIL("no parse error");
+	} catch (NP::Parse_error& e) {
+		CHECK(e.file == "dag.csv");
+		CHECK(e.line == 151);
+		CHECK(e.column == 4);
+		CHECK(std::string(e.what()) == "dag.csv:151:4: expected an integer");
+	}
+}
+
+const std::string abort_actions_file =
+"Task ID, Job ID, Trigger min, Trigger max, Cleanup min, Cleanup max\n"
+"    920,      2,       20000,       20010,           1,          10\n";
+
+TEST_CASE("[binary] job set round trip") {
+	auto jobs_in = std::istringstream(four_lines);
+	auto dag_in = std::istringstream(sequential_task_prec_file);
+	auto aborts_in = std::istringstream(abort_actions_file);
+
+	auto w = NP::load_workload<dense_t>(NP::Input_file(jobs_in),
+	                                    NP::Input_file(dag_in),
+	                                    NP::Input_file(aborts_in));
+
+	auto out = std::ostringstream();
+	NP::write_binary_job_set(out, w);
+	auto bin = std::istringstream(out.str());
+	NP::Input_file in(bin, "jobs.bin");
+
+	REQUIRE(NP::is_binary_job_set(in));
+	CHECK(in.size() == 64 + 8 * (3 * 8 + 2 * 4 + 1 * 6));
+
+	auto v = NP::load_workload<dense_t>(in, NP::Input_file(),
+	                                    NP::Input_file());
+
+	REQUIRE(v.jobs.size() == 3);
+	for (std::size_t i = 0; i < 3; i++) {
+		CHECK(v.jobs[i].get_id() == w.jobs[i].get_id());
+		CHECK(v.jobs[i].get_cost() == w.jobs[i].get_cost());
+		CHECK(v.jobs[i].latest_arrival() == w.jobs[i].latest_arrival());
+		CHECK(v.jobs[i].get_deadline() == w.jobs[i].get_deadline());
+		CHECK(v.jobs[i].get_key() == w.jobs[i].get_key());
+	}
+	CHECK(v.jobs[0].maximal_cost() == 838.6724123730141);
+
+	REQUIRE(v.dag.size() == 2);
+	CHECK(v.dag[1].first == NP::JobID(2, 920));
+	CHECK(v.dag[1].second == NP::JobID(3, 920));
+
+	REQUIRE(v.aborts.size() == 1);
+	CHECK(v.aborts[0].get_id() == NP::JobID(2, 920));
+	CHECK(v.aborts[0].latest_trigger_time() == 20010);
+
+	// dense time cannot be analyzed in discrete time
+	REQUIRE_THROWS_AS(NP::load_binary_job_set<dtime_t>(in),
+	                  NP::Invalid_binary_job_set);
+
+	// any change to the payload is detected
+	auto bad = out.str();
+	bad[100] ^= 1;
+	auto bad_bin = std::istringstream(bad);
+	REQUIRE_THROWS_AS(NP::load_binary_job_set<dense_t>(
+		NP::Input_file(bad_bin)), NP::Invalid_binary_job_set);
+}
+
+TEST_CASE("[json] request objects") {
+	auto obj = NP::JSON::parse_object(
+		"{\"id\": 7, \"jobs_csv\": \"a\\n\\\"b\\\"\\u00e9\", "
+		" \"naive\" : true, \"x\": null, \"t\": -1.5e2}");
+
+	REQUIRE(obj.size() == 5);
+	CHECK(obj["id"].type() == NP::JSON::Value::number);
+	CHECK(obj["id"].as_number() == 7);
+	CHECK(obj["jobs_csv"].as_string() == "a\n\"b\"\xc3\xa9");
+	CHECK(obj["naive"].as_bool());
+	CHECK(obj["x"].type() == NP::JSON::Value::null);
+	CHECK(obj["t"].as_number() == -150);
+
+	CHECK(NP::JSON::parse_object("  {}  ").empty());
+
+	try {
+		NP::JSON::parse_object("{\"a\": 1 \"b\": 2}", "request", 3);
+		FAIL("no parse error");
+	} catch (NP::Parse_error& e) {
+		CHECK(e.line == 3);
+		CHECK(e.column == 9);
+	}
+
+	REQUIRE_THROWS_AS(NP::JSON::parse_object("{\"a\": [1]}"), NP::Parse_error);
+	REQUIRE_THROWS_AS(NP::JSON::parse_object("{\"a\": 1, \"a\": 2}"), NP::Parse_error);
+	REQUIRE_THROWS_AS(NP::JSON::parse_object("{\"a\": \"b}"), NP::Parse_error);
+	REQUIRE_THROWS_AS(NP::JSON::parse_object("{\"a\": 1} x"), NP::Parse_error);
+}
+
+TEST_CASE("[json] response objects") {
+	std::ostringstream out;
+	{
+		NP::JSON::Writer w(out);
+		w.field("file", "a\"b\n")
+		 .field("schedulable", true)
+		 .field("jobs", 9ul)
+		 .field("time", 0.25)
+		 .field("id", NP::JSON::Value());
+	}
+	CHECK(out.str() == "{\"file\": \"a\\\"b\\n\", \"schedulable\": true, "
+	                   "\"jobs\": 9, \"time\": 0.25, \"id\": null}");
+
+	auto obj = NP::JSON::parse_object(out.str());
+	CHECK(obj["file"].as_string() == "a\"b\n");
+	CHECK(obj["time"].as_number() == 0.25);
+}
+
+#ifdef CONFIG_ZLIB
+
+#include <zlib.h>
+
+static std::string gzip(const std::string& text)
+{
+	z_stream zs{};
+	deflateInit2(&zs, 1, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY);
+	std::string out(deflateBound(&zs, text.size()), '\0');
+	zs.next_in = (Bytef*) text.data();
+	zs.avail_in = text.size();
+	zs.next_out = (Bytef*) &out[0];
+	zs.avail_out = out.size();
+	deflate(&zs, Z_FINISH);
+	out.resize(zs.total_out);
+	deflateEnd(&zs);
+	return out;
+}
+
+TEST_CASE("[compressed] decompressed in blocks that end at line breaks") {
+	std::string text;
+	for (int i = 0; i < 1000; i++)
+		text += std::to_string(i) + ", " + std::to_string(i * i) + "\n";
+	auto data = gzip(text);
+
+	REQUIRE(NP::compression_of(data.data(), data.size())
+	        == NP::Compression::gzip);
+
+	NP::Decompressing_stream stream(NP::Compression::gzip, data.data(),
+	                                data.size(), 256, 2);
+	std::string block, all;
+	int num_blocks = 0;
+	while (stream.next(block)) {
+		CHECK(block.back() == '\n');
+		all += block;
+		num_blocks++;
+	}
+	CHECK(num_blocks > 10);
+	CHECK(all == text);
+
+	auto truncated = data.substr(0, data.size() / 2);
+	NP::Decompressing_stream broken(NP::Compression::gzip,
+		truncated.data(), truncated.size(), 256, 2);
+	REQUIRE_THROWS_AS(while (broken.next(block)) {}, NP::Decompression_error);
+}
+
+TEST_CASE("[compressed] job set file") {
+	std::string text = "Task ID, Job ID, Arrival min, Arrival max, Cost min, Cost max, Deadline, Priority\n";
+	const int n = 60000;
+	for (int i = 1; i <= n; i++)
+		text += "1, " + std::to_string(i) + ", " + std::to_string(10 * i)
+		        + ", " + std::to_string(10 * i) + ", 1, 2, "
+		        + std::to_string(10 * i + 10) + ", 1\n";
+	REQUIRE(text.size() > 2 * (1 << 20));
+
+	auto compressed = std::istringstream(gzip(text));
+	NP::Input_file in(compressed, "jobs.csv.gz");
+	REQUIRE(in.is_compressed());
+	CHECK(in.prefix(7) == "Task ID");
+
+	auto jobs = NP::parse_file<dtime_t>(in);
+	REQUIRE(jobs.size() == n);
+	for (int i = 0; i < n; i++)
+		CHECK(jobs[i].get_job_id() == (unsigned long) i + 1);
+	CHECK(in.statistics().decompressed_bytes == text.size());
+
+	// job 50000 is on line 50001, in the second block or later
+	auto pos = text.find("\n1, 50000, ");
+	text[pos + 4] = 'x';
+	auto bad = std::istringstream(gzip(text));
+	try {
+		NP::parse_file<dtime_t>(NP::Input_file(bad, "jobs.csv.gz"));
+		FAIL("no parse error");
+	} catch (NP::Parse_error& e) {
+		CHECK(e.line == 50001);
+		CHECK(e.column == 4);
+	}
+}
+
+#endif
+
+#ifdef CONFIG_ZSTD
+
+#include <zstd.h>
+
+static std::string zstd(const std::string& text)
+{
+	std::string out(ZSTD_compressBound(text.size()), '\0');
+	out.resize(ZSTD_compress(&out[0], out.size(), text.data(), text.size(), 1));
+	return out;
+}
+
+TEST_CASE("[compressed] zstd frames decompressed in blocks that end at line breaks") {
+	std::string first, second;
+	for (int i = 0; i < 1000; i++)
+		(i < 600 ? first : second) += std::to_string(i) + ", "
+			+ std::to_string(i * i) + "\n";
+	// two concatenated frames, as written by zstd -c a b
+	auto data = zstd(first) + zstd(second);
+
+	REQUIRE(NP::compression_of(data.data(), data.size())
+	        == NP::Compression::zstd);
+
+	NP::Decompressing_stream stream(NP::Compression::zstd, data.data(),
+	                                data.size(), 256, 2);
+	std::string block, all;
+	int num_blocks = 0;
+	while (stream.next(block)) {
+		CHECK(block.back() == '\n');
+		all += block;
+		num_blocks++;
+	}
+	CHECK(num_blocks > 10);
+	CHECK(all == first + second);
+
+	auto truncated = data.substr(0, data.size() - 10);
+	NP::Decompressing_stream broken(NP::Compression::zstd,
+		truncated.data(), truncated.size(), 256, 2);
+	REQUIRE_THROWS_AS(while (broken.next(block)) {}, NP::Decompression_error);
+}
+
+TEST_CASE("[compressed] zstd job set file") {
+	std::string text = "Task ID, Job ID, Arrival min, Arrival max, Cost min, Cost max, Deadline, Priority\n";
+	const int n = 60000;
+	for (int i = 1; i <= n; i++)
+		text += "1, " + std::to_string(i) + ", " + std::to_string(10 * i)
+		        + ", " + std::to_string(10 * i) + ", 1, 2, "
+		        + std::to_string(10 * i + 10) + ", 1\n";
+	REQUIRE(text.size() > 2 * (1 << 20));
+
+	auto compressed = std::istringstream(zstd(text));
+	NP::Input_file in(compressed, "jobs.csv.zst");
+	REQUIRE(in.is_compressed());
+	CHECK(in.prefix(7) == "Task ID");
+
+	auto jobs = NP::parse_file<dtime_t>(in);
+	REQUIRE(jobs.size() == n);
+	for (int i = 0; i < n; i++)
+		CHECK(jobs[i].get_job_id() == (unsigned long) i + 1);
+	CHECK(in.statistics().decompressed_bytes == text.size());
+}
+
+#else
+
+TEST_CASE("[compressed] zstd input is rejected without zstd support") {
+	std::string data("\x28\xb5\x2f\xfd\x24\x00", 6);
+	REQUIRE(NP::compression_of(data.data(), data.size())
+	        == NP::Compression::zstd);
+	auto in = std::istringstream(data);
+	REQUIRE_THROWS_AS(NP::parse_file<dtime_t>(NP::Input_file(in, "jobs.csv.zst")),
+	                  NP::Decompression_error);
+}
+
+#endif